@@ -1,4 +1,5 @@
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
 #ifndef BOARD_H
@@ -6,7 +7,19 @@
 
 /* Min/Max width board */
 #define MIN_BOARD_SIZE 2
-#define MAX_BOARD_SIZE 10
+#define MAX_BOARD_SIZE 16
+
+/* 64 bits words of a bitboard, enough for the largest board. Boards only
+ * use the words they cover (1 up to 8x8, 2 for 10x10, 3 for 12x12) */
+#define BOARD_WORDS (((MAX_BOARD_SIZE * MAX_BOARD_SIZE) + 63) / 64)
+
+/* Bitboard: the cell (size * row) + column is bit cell % 64 of word
+ * cell / 64. The number of words is fixed at compile time by the largest
+ * board, the words beyond those of the board size stay 0 */
+typedef struct
+{
+  uint64_t word[BOARD_WORDS];
+} bitboard_t;
 
 /* Max int possible */
 #define MAX_INT 214748366
@@ -41,12 +54,69 @@ typedef struct
   unsigned short white;
 } score_t;
 
+/* Evaluation features of a position from the point of view of a player,
+ * every feature is the player's value minus the opponent's one.
+ * regions counts the discs of each value region of board_evaluat_discs
+ * (8x8 boards only) and disc_evaluation is their weighted sum. The
+ * potential mobility counts the empty squares next to a disc of the other
+ * side, and parity the quadrants with an odd number of empty squares,
+ * positive if the player is to move (who may then take the last move of
+ * each of them), negative otherwise */
+typedef struct
+{
+  int score;
+  int mobility;
+  int stable;
+  int disc_evaluation;
+  int frontiers;
+  int potential_mobility;
+  int parity;
+  int regions[8];
+} board_features_t;
+
+/* Result of the parsing functions */
+typedef enum {
+  PARSE_OK,
+  PARSE_END,              /* no position left in the file */
+  PARSE_ERROR_PLAYER,     /* player incorrect or missing */
+  PARSE_ERROR_CHARACTER,  /* unexpected character */
+  PARSE_ERROR_ROW,        /* row (or line) with a wrong number of cells */
+  PARSE_ERROR_ROWS,       /* extra or missing rows */
+  PARSE_ERROR_RECORD,     /* malformed or truncated binary record */
+  PARSE_ERROR_MEMORY
+} parse_error_t;
+
+/* Details on where board_parse stopped */
+typedef struct
+{
+  size_t line;      /* last line read, starting at 1 */
+  char character;   /* the wrong character of PARSE_ERROR_CHARACTER */
+  size_t rows;      /* rows read */
+  size_t size;      /* columns of the first row */
+} parse_info_t;
+
 /* Reversi board (forward declaration to hide the implementation) */
 typedef struct board_t board_t;
 
-/* board_alloc allocates a new board */
-board_t *board_alloc(const size_t size, const disc_t player,
-  const bool first_time);
+/* Size dependent tables shared by the boards of a size (hidden as well) */
+typedef struct board_context_t board_context_t;
+
+/* Compact position for the search: the discs of the player to move and of
+ * the opponent, and the legal moves of the player to move, none once the
+ * game is over. Unlike a board, a node is a plain value without the caches
+ * of board_t, copied and overwritten in place by the search, the size
+ * comes from the context given to the functions working on it */
+typedef struct
+{
+  bitboard_t player;
+  bitboard_t opponent;
+  bitboard_t moves;
+} board_node_t;
+
+/* board_alloc allocates a new board.
+ * The size dependent tables are shared by all boards of the same size and
+ * built once per process, so boards of any sizes can be used concurrently */
+board_t *board_alloc(const size_t size, const disc_t player);
 
 /* frees the previusly allocated board */
 void board_free(board_t *board);
@@ -54,6 +124,19 @@ void board_free(board_t *board);
 /* initiates the board with the starting discs. Player 'X' starts */
 board_t *board_init(const size_t size);
 
+/* returns a new board of the given discs with player to move, NULL if the
+ * size or player is invalid, a square is both black and white or a disc
+ * lies beyond the board. The moves, the passes (the opponent is to move
+ * if player has no move, EMPTY_DISC if neither has one) and the stable
+ * discs are computed once, not for every disc as with board_set */
+board_t *board_from_bitboards(const size_t size, const disc_t player,
+  const bitboard_t black, const bitboard_t white);
+
+/* as board_from_bitboards, from the size * size cells row after row, hints
+ * are empty squares. NULL if a cell is not a disc_t */
+board_t *board_from_cells(const size_t size, const disc_t player,
+  const disc_t cells[]);
+
 /* returns a deep copy of the board */
 board_t *board_copy(const board_t *board);
 
@@ -78,6 +161,10 @@ void board_set(board_t *board, const disc_t disc, const size_t row,
 /* returns the current board score */
 score_t board_score(const board_t *board);
 
+/* returns a 64 bits hash of the discs, the size and the player to move, equal
+ * positions have equal hashes */
+uint64_t board_hash(const board_t *board);
+
 /* return how many turns until the board is completetd with discs */
 size_t turns_left(board_t *board);
 
@@ -99,6 +186,17 @@ int board_frontiers(board_t *board, disc_t player);
 /* evaluates the stable discs of a board for a current player */
 int board_stable(board_t *board, disc_t player);
 
+/* computes the features of a board for player, the same values as the
+ * score, board_mobility, board_stable (when a stable disc is possible),
+ * board_evaluat_discs and board_frontiers */
+void board_features(board_t *board, const disc_t player,
+  board_features_t *features);
+
+/* computes the features of count boards of the same size for player.
+ * Boards up to 8x8 are evaluated several at a time with AVX2 */
+void board_features_batch(board_t *const boards[], const size_t count,
+  const disc_t player, board_features_t features[]);
+
 /* returns the amount of possible moves a player has */
 size_t board_count_player_moves(board_t *board);
 
@@ -123,7 +221,133 @@ bool board_play(board_t *board, const move_t move);
  * Starts at the back of the bitboard and works its way to the front. */
 move_t board_next_move(board_t *board);
 
+/* returns a uniformly chosen legal move, drawn from the random generator
+ * of the calling thread. Returns row=column=MAX_BOARD_SIZE+1 if the
+ * current player has no move */
+move_t board_random_move(const board_t *board);
+
+/* plays random moves from the given position (which is left untouched)
+ * until the game is over and returns the final score */
+score_t board_random_playout(const board_t *board);
+
+/* counts the leaves of the game tree of the given depth (a pass is a ply,
+ * a finished game is a leaf), used to check and time the move generator */
+uint64_t board_perft(const board_t *board, const size_t depth);
+
+/* returns the size dependent tables of the board, for its nodes */
+const board_context_t *board_get_context(const board_t *board);
+
+/* sets node to the position of the board */
+void board_node_init(board_node_t *node, const board_t *board);
+
+/* plays the move on square (size * row + column, a legal move) of node into
+ * child, which may be node itself. If the opponent has no move but the
+ * player has, the opponent passes: the player is to move in child and true
+ * is returned. A finished game has the opponent to move and no move */
+bool board_node_play(const board_context_t *context, const board_node_t *node,
+  const size_t square, board_node_t *child);
+
+/* writes the squares of the moves of node, highest first as
+ * board_next_move gives them, and returns their number */
+size_t board_node_moves(const board_context_t *context,
+  const board_node_t *node, unsigned short squares[]);
+
+/* returns true if the game of node is over */
+bool board_node_finished(const board_context_t *context,
+  const board_node_t *node);
+
+/* returns the number of empty squares of node */
+size_t board_node_empties(const board_context_t *context,
+  const board_node_t *node);
+
+/* returns the game stage of node, as stage_of_game */
+game_stage board_node_stage(const board_context_t *context,
+  const board_node_t *node);
+
+/* returns the discs of the player to move minus those of the opponent */
+int board_node_score(const board_context_t *context, const board_node_t *node);
+
+/* returns a 64 bits hash of the discs and the size, equal positions have
+ * equal hashes whatever the color of the player to move */
+uint64_t board_node_hash(const board_context_t *context,
+  const board_node_t *node);
+
+/* computes the features of node for the player to move, as board_features
+ * on a board whose stable discs were not computed before */
+void board_node_features(const board_context_t *context,
+  const board_node_t *node, board_features_t *features);
+
+/* computes the features of count nodes as board_node_features. Nodes up
+ * to 8x8 are evaluated several at a time with AVX2 */
+void board_node_features_batch(const board_context_t *context,
+  const board_node_t nodes[], const size_t count,
+  board_features_t features[]);
+
 /* prints the current board on the given file descriptor */
 int board_print(const board_t *board, FILE *fd);
 
+/* parses a board in the file format of the game: the player ('X' or 'O')
+ * then one row of discs per line, '#' starts a comment.
+ * On success *board is a new board, info (which may be NULL) tells
+ * where the parsing stopped on errors */
+parse_error_t board_parse(const char *text, const size_t length,
+  board_t **board, parse_info_t *info);
+
+/* Position files hold many positions, either as text with one position
+ * per line (all cells row after row, then the player to move, e.g.
+ * "___________________________OX______XO___________________________ X"),
+ * or as binary: POSITIONS_MAGIC followed by records of one byte
+ * ((size % 16) << 2 | player, 0: none, 1: 'X', 2: 'O') and the black and
+ * white bitboards, little endian, 8 bytes per 64 bits word of the size.
+ * A position may carry a label, the final score (black minus white discs)
+ * of the game it comes from: an int at the end of the line in text, and a
+ * signed byte after the bitboards, flagged by 0x40 in the first byte, in
+ * binary (clamped to -128..126, beyond 10x10 a score may not fit) */
+#define POSITIONS_MAGIC "RVPOS01\n"
+
+/* longest binary record of a position */
+#define POSITION_MAX_RECORD (2 + (16 * BOARD_WORDS))
+
+/* label of a position which has none */
+#define POSITION_NO_LABEL 127
+
+/* A position file opened for reading (memory mapped) */
+typedef struct positions_t positions_t;
+
+/* parses one line of a text position file into an existing board of any
+ * size, the derived state (moves, passes) is computed once.
+ * label (may be NULL) receives the label or POSITION_NO_LABEL */
+parse_error_t board_parse_line(board_t *board, const char *text,
+  const size_t length, int *label);
+
+/* prints the board as one line of a text position file, label may be
+ * POSITION_NO_LABEL */
+int board_print_line(const board_t *board, const int label, FILE *fd);
+
+/* returns the number of bytes of the binary record of the board */
+size_t board_record_length(const board_t *board, const int label);
+
+/* writes the binary record of the board and returns its length */
+size_t board_write_record(const board_t *board, const int label,
+  unsigned char *buffer);
+
+/* reads a binary record of at most available bytes into an existing board
+ * and sets used to the length of the record, label as board_parse_line */
+parse_error_t board_read_record(board_t *board, const unsigned char *buffer,
+  const size_t available, size_t *used, int *label);
+
+/* maps a position file (text or binary) in memory, NULL if it fails */
+positions_t *positions_open(const char *filename);
+
+/* reads the next position into an existing board, returns PARSE_END once
+ * every position was read, label as board_parse_line */
+parse_error_t positions_next(positions_t *positions, board_t *board,
+  int *label);
+
+/* returns the line (or record) number of the last position read */
+size_t positions_line(const positions_t *positions);
+
+/* unmaps a position file */
+void positions_close(positions_t *positions);
+
 #endif /* BOARD_H */
@@ -0,0 +1,72 @@
+#ifndef GAMES_H
+#define GAMES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <board.h>
+
+/* Game files store finished games, appended one after the other:
+ * GAMES_MAGIC, then for every game a header of 4 bytes (size, flags,
+ * result as a signed byte, number of moves), the start position as a
+ * binary position record if flag GAME_CUSTOM_START is set, and one byte
+ * per move (row * size + column). Passes are not stored, replaying the
+ * moves with board_play finds them again. Results beyond a signed byte
+ * (boards above 10x10) are clamped, only their sign is kept for sure */
+#define GAMES_MAGIC "RVGAME01"
+#define GAME_CUSTOM_START 0x1
+
+/* moves and start record of a game are bounded by the largest board */
+#define GAME_MAX_MOVES (MAX_BOARD_SIZE * MAX_BOARD_SIZE)
+#define GAME_MAX_START POSITION_MAX_RECORD
+
+/* A game, as it is stored in a game file */
+typedef struct
+{
+  size_t size;
+  int result;          /* black discs minus white discs at the end */
+  size_t count;        /* number of moves */
+  move_t moves[GAME_MAX_MOVES];
+  size_t start_length; /* 0 if the game starts from board_init */
+  unsigned char start[GAME_MAX_START];
+} game_record_t;
+
+/* A game file opened for appending, shared by many threads */
+typedef struct games_writer_t games_writer_t;
+
+/* A game file opened for reading (memory mapped) */
+typedef struct games_reader_t games_reader_t;
+
+/* starts the record of a game played from the given position */
+void game_record_init(game_record_t *game, const board_t *start);
+
+/* adds a move played in the game */
+void game_record_add(game_record_t *game, const move_t move);
+
+/* sets the result of the game from its final board */
+void game_record_finish(game_record_t *game, const board_t *board);
+
+/* returns a new board with the start position of the game */
+board_t *game_record_start(const game_record_t *game);
+
+/* opens (or creates) a game file for appending, NULL if it fails */
+games_writer_t *games_writer_open(const char *filename);
+
+/* appends a game, can be called from several threads at once. Games are
+ * buffered and every write to the file holds whole games only, so several
+ * processes can also append to the same file */
+bool games_writer_append(games_writer_t *writer, const game_record_t *game);
+
+/* writes the buffered games and closes the file */
+bool games_writer_close(games_writer_t *writer);
+
+/* maps a game file in memory, NULL if it fails or is not a game file */
+games_reader_t *games_reader_open(const char *filename);
+
+/* reads the next game, returns PARSE_END once every game was read */
+parse_error_t games_reader_next(games_reader_t *reader, game_record_t *game);
+
+/* unmaps a game file */
+void games_reader_close(games_reader_t *reader);
+
+#endif /* GAMES_H */
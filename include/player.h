@@ -3,8 +3,76 @@
 
 #include <board.h>
 
-/* MAX_TIME is the maximum time a AI has to make a move in sec */
-#define MAX_TIME 29
+/* Weights of the evaluation features for one stage of the game */
+typedef struct
+{
+  int score;
+  int mobility;
+  int stable;
+  int frontiers;
+  /* value of the discs in every region of board_evaluat_discs (8x8) */
+  int regions[8];
+  int potential_mobility;
+  int parity;
+} heuristic_weights_t;
+
+/* returns the evaluation weights of a stage */
+heuristic_weights_t get_weights(game_stage stage);
+
+/* replaces the evaluation weights of a stage */
+void set_weights(game_stage stage, heuristic_weights_t stage_weights);
+
+/* writes the evaluation weights of all stages into a text file,
+ * one line per stage, returns false on failure */
+bool save_weights(const char *filename);
+
+/* loads a file written by save_weights, the weights are left unchanged
+ * and false returned if it is unreadable or incomplete. Lines without the
+ * potential mobility and parity weights leave them 0 */
+bool load_weights(const char *filename);
+
+/* returns the heuristic value of a position for player, with the weights
+ * of its game stage */
+int final_heuristic(board_t *board, disc_t player);
+
+/* returns the heuristic value of a search node for the player to move, as
+ * final_heuristic */
+int final_heuristic_node(const board_context_t *context,
+  const board_node_t *node);
+
+/* writes the heuristic values of count search nodes to values, as
+ * final_heuristic_node but evaluating several nodes at a time */
+void final_heuristic_node_batch(const board_context_t *context,
+  const board_node_t nodes[], size_t count, int values[]);
+
+/* gives the AI players a game clock of seconds plus increment per move,
+ * they deepen their search as long as the clock allows. A zero time
+ * (default) makes them search at a fixed depth */
+void set_time_control(double seconds, double increment);
+
+/* sets the clocks of both players back to the time control, at the start
+ * of every game of the calling thread */
+void reset_game_clocks(void);
+
+/* limits every search of the AI players to nodes, they deepen as far as it
+ * allows. Their moves then are the same on every run and machine. Zero
+ * (default) sets no limit */
+void set_node_limit(uint64_t nodes);
+
+/* empty squares from which the AI players solve the game exactly by
+ * default */
+#define ENDGAME_EMPTIES 9
+
+/* makes the AI players and the contest solve the game exactly from
+ * empties empty squares on (default ENDGAME_EMPTIES), sharing the solve
+ * between threads (default 1) */
+void set_endgame(size_t empties, size_t threads);
+
+/* returns the empty squares of the exact endgame set by set_endgame */
+size_t get_endgame_empties(void);
+
+/* returns the threads of the exact endgame set by set_endgame */
+size_t get_endgame_threads(void);
 
 /* A player function move_t (*player_func) (board_t *) returns a
  * chosen move depending on the given board. */
@@ -19,15 +87,24 @@ move_t human_player(board_t *board);
 /* returns a random move from all moves possible moves */
 move_t random_player(board_t *board);
 
-/* calls the minmax_player methode with a depth of 3 */
+/* plays the best move of the solver database if the position is in it,
+ * else calls the minmax_ab_player methode with a depth of 4, or deepens on
+ * its game clock if there is a time control and up to its node limit if
+ * there is one */
 move_t ai_player(board_t *board);
 
+/* plays like ai_player without the selective pruning (late move reductions
+ * and ProbCut), the reference to measure it in tournaments */
+move_t full_width_player(board_t *board);
+
 /* evaluates the best move
  * according to the minimax tree search algorithm up to a given depth */
 move_t minmax_player(board_t *board, size_t depth);
 
 /* evaluates the best move according to the
- * minimax tree search algorithm with ab prunning up to a given depth */
+ * minimax tree search algorithm with ab prunning up to a given depth,
+ * pruning further with late move reductions and Multi-ProbCut at the
+ * selectivity of get_selectivity */
 move_t minmax_ab_player(board_t *board, size_t depth);
 
 #endif /* PLAYER_H */
@@ -0,0 +1,25 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Work stealing thread pool: every worker has its own queue of tasks,
+ * submitted tasks are spread over the queues in turn and a worker whose
+ * queue is empty steals the oldest task of another one. Tasks are taken
+ * oldest first, so that no task waits behind many younger ones */
+typedef struct pool_t pool_t;
+
+/* starts a pool of threads workers (at least 1), NULL on failure */
+pool_t *pool_new(size_t threads);
+
+/* queues run(argument) for a worker, returns false if out of memory */
+bool pool_submit(pool_t *pool, void (*run)(void *), void *argument);
+
+/* returns the number of workers of the pool */
+size_t pool_threads(const pool_t *pool);
+
+/* runs the tasks left, stops the workers and frees the pool */
+void pool_free(pool_t *pool);
+
+#endif /* POOL_H */
@@ -0,0 +1,20 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* Fast pseudo random number generator (xoshiro256**).
+ * Every thread owns its own generator state, so no locking is needed and
+ * threads never share a sequence. A thread that never called rng_seed is
+ * seeded lazily from the clock on its first draw. */
+
+/* seeds the generator of the calling thread */
+void rng_seed(uint64_t seed);
+
+/* returns the next 64 random bits of the calling thread's generator */
+uint64_t rng_next(void);
+
+/* returns a uniformly distributed integer in [0, bound), bound > 0 */
+uint64_t rng_bounded(uint64_t bound);
+
+#endif /* RNG_H */
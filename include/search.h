@@ -0,0 +1,181 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <board.h>
+
+/* Scores of finished games are SEARCH_WIN plus the disc difference for the
+ * winner, so that they are beyond every heuristic value */
+#define SEARCH_WIN 10000
+
+/* Selectivity levels of Multi-ProbCut, from 0 (full width search) to
+ * SEARCH_MAX_SELECTIVITY (most pruning) */
+#define SEARCH_MAX_SELECTIVITY 5
+
+/* longest line of play, every move fills a square */
+#define SEARCH_MAX_PLY (MAX_BOARD_SIZE * MAX_BOARD_SIZE)
+
+/* most legal moves of a position */
+#define SEARCH_MAX_MOVES (MAX_BOARD_SIZE * MAX_BOARD_SIZE)
+
+/* Score of a legal move, seen from the player to move */
+typedef struct
+{
+  move_t move;
+  int score;
+} move_score_t;
+
+/* Outcome of a search, the score is seen from the player to move */
+typedef struct
+{
+  move_t move;
+  int score;
+  /* depth of the last completed iteration */
+  size_t depth;
+  /* the search reached the end of the game, the scores are exact */
+  bool exact;
+  uint64_t nodes;
+  /* heuristic values asked for by the search, and those answered by the
+   * evaluation cache */
+  uint64_t evaluations;
+  uint64_t eval_hits;
+  /* searches repeated because the score fell out of the aspiration window */
+  size_t researches;
+  /* principal variation, the expected line of play starting with move */
+  size_t pv_length;
+  move_t pv[SEARCH_MAX_PLY];
+  /* with the analysis option, the score of every legal move, best first */
+  size_t scored;
+  move_score_t scores[SEARCH_MAX_MOVES];
+} search_result_t;
+
+/* Clock of a player for the whole game */
+typedef struct
+{
+  /* seconds left */
+  double remaining;
+  /* seconds added after every move */
+  double increment;
+} game_clock_t;
+
+/* Limits and pruning of a search */
+typedef struct
+{
+  size_t depth;
+  /* time control, the time of the search is taken from it and the increment
+   * added. NULL searches to depth without time limit */
+  game_clock_t *clock;
+  /* nodes after which the search stops, 0 for no limit. Unlike the clock,
+   * the result then only depends on the position */
+  uint64_t max_nodes;
+  /* Multi-ProbCut level, 0 searches full width */
+  int selectivity;
+  /* late move reductions: the moves ordered last are searched less deep
+   * unless they turn out better */
+  bool reductions;
+  /* scores every legal move instead of only proving the best one */
+  bool analysis;
+  /* threads searching the iterations that reach the end of the game, the
+   * calling one included: the moves after the first of deep nodes are
+   * shared between them. 0 or 1 searches in the calling thread only */
+  size_t threads;
+  /* flag set by another thread to stop the search as search_stop does,
+   * NULL for none. Ignored by search_start, which has its own */
+  atomic_bool *stop;
+} search_options_t;
+
+/* iterative deepening principal variation search of the position up to
+ * depth, with aspiration windows, a transposition table and the pruning of
+ * the options. The table belongs to the calling thread and is reused,
+ * without its entries, by its next searches. With a clock, the search
+ * deepens until the time given to the move is used and returns the result
+ * of the last completed iteration.
+ * The analysis option searches every legal move with its own window in
+ * the same iterations and transposition table, which costs a few times a
+ * search of the best move alone, instead of one search per move.
+ * The move is row=MAX_BOARD_SIZE+1 and column=MAX_BOARD_SIZE+1 if the
+ * player has no move */
+search_result_t search_position(board_t *board,
+  const search_options_t *options);
+
+/* Search running in a thread of its own (hidden implementation) */
+typedef struct search_handle_t search_handle_t;
+
+/* starts search_position on a copy of the board in a new thread and
+ * returns at once, NULL if the thread cannot be started. The clock of the
+ * options, if any, is updated when the search ends and must stay valid
+ * until search_wait */
+search_handle_t *search_start(const board_t *board,
+  const search_options_t *options);
+
+/* copies the best result so far, that of the last completed iteration
+ * (depth 0 and no move before the first one), into result. Returns true
+ * once the search has ended, result is then the final one */
+bool search_poll(search_handle_t *handle, search_result_t *result);
+
+/* asks the search to stop, it returns within a node and keeps the result
+ * of the last completed iteration. Returns at once */
+void search_stop(search_handle_t *handle);
+
+/* waits for the end of the search, frees the handle and returns the
+ * result, as search_position would */
+search_result_t search_wait(search_handle_t *handle);
+
+/* makes the following searches use the transposition table of a file,
+ * created if missing, instead of a table of their own. The file is mapped
+ * into memory and written without lock by concurrent threads and
+ * processes, whose torn or foreign entries fail a check and are ignored,
+ * so it carries the searches of a game from one process to the next.
+ * Returns false if the file cannot be created or mapped, or holds
+ * something else than a table */
+bool search_open_table(const char *filename);
+
+/* unmaps the table file, the following searches use their own tables */
+void search_close_table(void);
+
+/* prints the result of every iteration of the following searches to fd,
+ * NULL (default) prints nothing */
+void set_search_output(FILE *fd);
+
+/* prints the principal variation of a result as moves separated by
+ * spaces, e.g. "d3 c5 f6" */
+void search_print_pv(const search_result_t *result, FILE *fd);
+
+/* returns the selectivity used by the AI players */
+int get_selectivity(void);
+
+/* sets the selectivity used by the AI players */
+void set_selectivity(int selectivity);
+
+/* fits the ProbCut regression parameters of every board size, game stage
+ * and depth up to max_depth, with full width searches of the positions of
+ * a position file, and writes them with probcut_save. Sizes without
+ * positions keep their parameters, only 8x8 has defaults and the other
+ * sizes are searched without ProbCut until fitted. Returns false if the
+ * positions cannot be read or the parameters written */
+bool probcut_fit(const char *positions_file, const char *probcut_file,
+  size_t max_depth, size_t threads, bool verbose);
+
+/* writes the ProbCut parameters into a text file, one line per board size,
+ * stage and depth, returns false on failure */
+bool probcut_save(const char *filename);
+
+/* loads a file written by probcut_save, replacing the parameters of the
+ * sizes it holds (lines without a size, from older files, are 8x8). The
+ * parameters are left unchanged and false returned if it is unreadable or
+ * malformated */
+bool probcut_load(const char *filename);
+
+/* searches the positions of a position file at full width, then with late
+ * move reductions at every selectivity level, and prints the nodes, the
+ * time, the agreement with the full width search and
+ * the depth that iterative deepening reaches with the nodes of the full
+ * width search */
+bool search_benchmark(const char *positions_file, size_t depth);
+
+#endif /* SEARCH_H */
@@ -0,0 +1,38 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Game server: hosts many games at once, one per connection to a local
+ * (Unix domain) socket, from a single non-blocking event loop. The moves
+ * of the program are searched by a shared work stealing pool, every game
+ * with its own clock, and a game waits for at most one move at a time so
+ * that busy games cannot starve the others. Commands and answers are lines
+ * of text:
+ *   new SIZE [SECONDS]  starts a game of width SIZE at the start position,
+ *                       the program has a clock of SECONDS for the game
+ *                       (SERVER_GAME_TIME by default), answers "ok"
+ *   play MOVE           plays MOVE (e.g. "d3") for the player to move,
+ *                       answers "ok", or "end BLACK WHITE" with the final
+ *                       discs if the game is over
+ *   go                  lets the program play for the player to move,
+ *                       answers "move MOVE", followed by " end BLACK WHITE"
+ *                       if the game is over
+ *   board               answers the position as a line of a text position
+ *                       file
+ *   stats               answers the games hosted, the moves of the program
+ *                       and their 50th and 99th percentile latency, from
+ *                       the command to the answer, in milliseconds
+ *   quit                closes the connection
+ * and errors are answered by "error" and a reason. A connection leaving
+ * more than a megabyte of answers unread is closed */
+#define SERVER_GAME_TIME 60.0
+
+/* listens on the socket path (replaced if it exists) and serves games
+ * with threads workers until SIGINT or SIGTERM, which stop the searches
+ * under way unanswered, then prints the latency statistics. Returns false
+ * if the socket or the workers cannot be created */
+bool server_run(const char *path, size_t threads, bool verbose);
+
+#endif /* SERVER_H */
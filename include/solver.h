@@ -0,0 +1,41 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <board.h>
+
+/* Strong solver of the small boards: every position reachable from a start
+ * position is solved exactly and stored once for its 8 symmetric forms in
+ * a database, from which the players then answer without searching.
+ * Database files are SOLVER_MAGIC, the board size and the number of
+ * positions as 8 bytes little endian, then the keys of the positions
+ * (base 3 code of the squares of the smallest symmetric form, times 2,
+ * plus 1 if white is to move, plus 1) sorted as 8 bytes little endian,
+ * then their final disc differences for the player to move as signed
+ * bytes, then the squares of their best moves in the smallest form */
+#define SOLVER_MAGIC "RVSOLV01"
+
+/* largest board whose positions fit in the 64 bits keys */
+#define SOLVER_MAX_SIZE 6
+
+/* solves every position reachable from start in up to horizon moves, the
+ * positions at the horizon with an exact alpha-beta search, on the given
+ * number of threads, and writes them into a database file. A horizon
+ * beyond the end of the game solves the whole game (4x4, a 6x6 game has
+ * far too many positions). Returns false if the board is too large, the
+ * positions do not fit in memory or the file cannot be written */
+bool solver_build(const board_t *start, size_t horizon, size_t threads,
+  const char *filename, bool verbose);
+
+/* loads a database file, replacing the loaded one, returns false if it is
+ * unreadable or malformated */
+bool solver_load(const char *filename);
+
+/* looks the position up in the loaded database, sets the final disc
+ * difference for the player to move with best play and the best move.
+ * Returns false if it is not in the database */
+bool solver_lookup(const board_t *board, int *value, move_t *move);
+
+#endif /* SOLVER_H */
@@ -0,0 +1,16 @@
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* fits the evaluation weights of every game stage to the labeled positions
+ * of a position file (Texel's method: logistic regression of the game
+ * result on the evaluation features, minimizing its cross entropy) with the
+ * given number of threads, starting from the current weights, and writes
+ * them with save_weights. Returns false if the positions cannot be read or
+ * the weights written */
+bool tune_weights(const char *positions_file, const char *weights_file,
+  size_t iterations, size_t threads, bool verbose);
+
+#endif /* TUNER_H */
@@ -1,20 +1,222 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "board.h"
+#include "rng.h"
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define BOARD_AVX2
+#endif
+
+#define BITBOARD_ZERO ((bitboard_t) { { 0 } })
+
+/* Every operation works on the first words of its operands only, the
+ * number of words of the board size, and is unrolled and inlined. The
+ * kernels call them with a constant count, so that they are compiled once
+ * per count and a board only pays for the words it covers. The results
+ * are 0 beyond words */
+
+__attribute__((always_inline))
+static inline bitboard_t bitboard_and(const bitboard_t a, const bitboard_t b,
+  const size_t words){
+  bitboard_t result = BITBOARD_ZERO;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    result.word[i] = a.word[i] & b.word[i];
+  }
+  return result;
+}
+
+__attribute__((always_inline))
+static inline bitboard_t bitboard_or(const bitboard_t a, const bitboard_t b,
+  const size_t words){
+  bitboard_t result = BITBOARD_ZERO;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    result.word[i] = a.word[i] | b.word[i];
+  }
+  return result;
+}
+
+__attribute__((always_inline))
+static inline bitboard_t bitboard_xor(const bitboard_t a, const bitboard_t b,
+  const size_t words){
+  bitboard_t result = BITBOARD_ZERO;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    result.word[i] = a.word[i] ^ b.word[i];
+  }
+  return result;
+}
+
+/* a & ~b */
+__attribute__((always_inline))
+static inline bitboard_t bitboard_andnot(const bitboard_t a,
+  const bitboard_t b, const size_t words){
+  bitboard_t result = BITBOARD_ZERO;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    result.word[i] = a.word[i] & ~b.word[i];
+  }
+  return result;
+}
+
+/* shifts towards the lower cells by 0 < n < 64, across the words */
+__attribute__((always_inline))
+static inline bitboard_t bitboard_shift_right(const bitboard_t a,
+  const unsigned n, const size_t words){
+  bitboard_t result = BITBOARD_ZERO;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    result.word[i] = a.word[i] >> n;
+    if(i + 1 < words && i + 1 < BOARD_WORDS){
+      result.word[i] |= a.word[i + 1] << (64 - n);
+    }
+  }
+  return result;
+}
+
+/* shifts towards the higher cells by 0 < n < 64, the bits leaving the last
+ * word are lost */
+__attribute__((always_inline))
+static inline bitboard_t bitboard_shift_left(const bitboard_t a,
+  const unsigned n, const size_t words){
+  bitboard_t result = BITBOARD_ZERO;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    result.word[i] = a.word[i] << n;
+    if(i > 0){
+      result.word[i] |= a.word[i - 1] >> (64 - n);
+    }
+  }
+  return result;
+}
+
+__attribute__((always_inline))
+static inline bool bitboard_is_zero(const bitboard_t a, const size_t words){
+  uint64_t any = 0;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    any |= a.word[i];
+  }
+  return any == 0;
+}
+
+__attribute__((always_inline))
+static inline bool bitboard_equal(const bitboard_t a, const bitboard_t b,
+  const size_t words){
+  uint64_t differ = 0;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    differ |= a.word[i] ^ b.word[i];
+  }
+  return differ == 0;
+}
+
+__attribute__((always_inline))
+static inline size_t bitboard_popcount(const bitboard_t a,
+  const size_t words){
+  size_t count = 0;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    count += __builtin_popcountll(a.word[i]);
+  }
+  return count;
+}
+
+/* returns the lowest set bit of a non empty bitboard */
+__attribute__((always_inline))
+static inline bitboard_t bitboard_lowest(const bitboard_t a,
+  const size_t words){
+  bitboard_t result = BITBOARD_ZERO;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    if(a.word[i] != 0){
+      result.word[i] = a.word[i] & -a.word[i];
+      break;
+    }
+  }
+  return result;
+}
+
+/* returns the index of the highest set bit, -1 if there is none */
+__attribute__((always_inline))
+static inline int bitboard_highest(const bitboard_t a, const size_t words){
+  for(size_t i = (words < BOARD_WORDS ? words : BOARD_WORDS); i > 0; i--){
+    if(a.word[i - 1] != 0){
+      return (64 * (i - 1)) + 63 - __builtin_clzll(a.word[i - 1]);
+    }
+  }
+  return -1;
+}
+
+__attribute__((always_inline))
+static inline bitboard_t bitboard_bit(const size_t index){
+  bitboard_t result = BITBOARD_ZERO;
+  result.word[index / 64] = (uint64_t) 1 << (index % 64);
+  return result;
+}
+
+__attribute__((always_inline))
+static inline bool bitboard_test(const bitboard_t a, const size_t index){
+  return (a.word[index / 64] >> (index % 64)) & 0x1;
+}
+
+__attribute__((always_inline))
+static inline void bitboard_set_bit(bitboard_t *a, const size_t index){
+  a->word[index / 64] |= (uint64_t) 1 << (index % 64);
+}
 
-/* Base bitboard type*/
-typedef unsigned __int128 bitboard_t;
+/* Size dependent tables, built once per size and then shared read only by
+ * every board of that size, so boards of different sizes can live (and be
+ * searched) side by side in one process and in several threads.
+ * The 8 directions are split into 4 right shifts (north, west, ne, nw)
+ * and 4 left shifts (south, east, sw, se), each with its wrap mask */
+struct board_context_t
+{
+  size_t size;
+  /* words of the bitboards of this size */
+  size_t words;
+  bitboard_t full;
+  unsigned shift[4];
+  bitboard_t right_mask[4];
+  bitboard_t left_mask[4];
+  /* the corners, serves to check if a stable piece is possible */
+  bitboard_t stable_check;
+  /* positions with the same value for board_evaluat_discs (size 8 only) */
+  bitboard_t regions[8];
+  /* the four quadrants of the board, for the parity of the empty squares */
+  bitboard_t quadrants[4];
+  /* 64 bits copies of shift and masks for the AVX2 path, which is taken
+   * when the board fits in 64 bits and the CPU supports AVX2.
+   * avx512_popcount adds the AVX-512 popcount to the batch evaluation,
+   * bmi2 lets the random playouts pick a move with pdep, popcnt lets
+   * board_node_features count with the instruction instead of a call */
+  bool avx2;
+  bool avx512_popcount;
+  bool bmi2;
+  bool popcnt;
+  uint64_t shift_64[4];
+  uint64_t right_mask_64[4];
+  uint64_t left_mask_64[4];
+};
 
 /* Internal board_t structiure(hiden from the outside) */
 struct board_t
 {
+  const board_context_t *context;
   size_t size;
   disc_t player;
   bitboard_t black;
@@ -27,132 +229,348 @@ struct board_t
 
 static bitboard_t set_bitboard(const size_t size, const size_t row,
   const size_t column){
-  bitboard_t board = 1;
-  board = board << ((size * row) + column);
-  return board;
+  return bitboard_bit((size * row) + column);
 }
 
-static bitboard_t shift_north(const size_t size, const bitboard_t bitboard){
-  return bitboard >> size;
-}
+/* value of each region of board_evaluat_discs */
+static const int region_values[8] = { 20, -3, 11, 8, -7, -4, 1, 2 };
+
+/* region of each position of a 8x8 board, the values of the regions are
+ * given by region_values */
+static const unsigned char regions_8[8][8] = {
+  { 0, 1, 2, 3, 3, 2, 1, 0 },
+  { 1, 4, 5, 6, 6, 5, 4, 1 },
+  { 2, 5, 7, 7, 7, 7, 5, 2 },
+  { 3, 6, 7, 1, 1, 7, 6, 3 },
+  { 3, 6, 7, 1, 1, 7, 6, 3 },
+  { 2, 5, 7, 7, 7, 7, 5, 2 },
+  { 1, 4, 5, 6, 6, 5, 4, 1 },
+  { 0, 1, 2, 3, 3, 2, 1, 0 }
+};
 
-static bitboard_t shift_south(const size_t size, const bitboard_t bitboard){
-  bitboard_t board = bitboard << size;
-  bitboard_t masc = ~0;
-  masc = masc >> (128 - (size * size));
-  board = board & masc;
-  return board;
-}
+/* one context per even size from MIN_BOARD_SIZE to MAX_BOARD_SIZE */
+static board_context_t contexts[MAX_BOARD_SIZE / 2];
+static pthread_once_t contexts_once = PTHREAD_ONCE_INIT;
 
-static bitboard_t shift_east(const size_t size, const bitboard_t bitboard){
-  bitboard_t board = bitboard << 1;
-  bitboard_t masc = set_bitboard(size, 0, 0);
+static void context_init(board_context_t *context, const size_t size){
+  bitboard_t full = BITBOARD_ZERO;
+  bitboard_t not_first_column = BITBOARD_ZERO;
+  bitboard_t not_last_column = BITBOARD_ZERO;
   for(size_t i = 0; i < (size * size); i++){
-    masc = masc << 1;
-    if((i+1) % size != 0){
-      masc += 1;
+    bitboard_set_bit(&full, i);
+    if(i % size != 0){
+      bitboard_set_bit(&not_first_column, i);
+    }
+    if(i % size != size - 1){
+      bitboard_set_bit(&not_last_column, i);
     }
   }
-  board = board & masc;
-  return board;
-}
+  context->size = size;
+  context->words = ((size * size) + 63) / 64;
+  context->full = full;
+  context->shift[0] = size;
+  context->shift[1] = 1;
+  context->shift[2] = size - 1;
+  context->shift[3] = size + 1;
+  context->right_mask[0] = full;
+  context->right_mask[1] = not_last_column;
+  context->right_mask[2] = not_first_column;
+  context->right_mask[3] = not_last_column;
+  context->left_mask[0] = full;
+  context->left_mask[1] = not_first_column;
+  context->left_mask[2] = not_last_column;
+  context->left_mask[3] = not_first_column;
+
+  for(int q = 0; q < 4; q++){
+    context->quadrants[q] = BITBOARD_ZERO;
+  }
+  for(size_t i = 0; i < size * size; i++){
+    const size_t row = i / size;
+    const size_t column = i % size;
+    bitboard_set_bit(&context->quadrants[(2 * (row >= size / 2)) +
+      (column >= size / 2)], i);
+  }
 
-static bitboard_t shift_west(const size_t size, const bitboard_t bitboard){
-  bitboard_t board = bitboard >> 1;
-  bitboard_t masc = 0;
-  for(size_t i = 0; i < (size * size); i++){
-    masc = masc << 1;
-    if(i % size != 0){
-      masc += 1;
+  context->stable_check = BITBOARD_ZERO;
+  bitboard_set_bit(&context->stable_check, 0);
+  bitboard_set_bit(&context->stable_check, size - 1);
+  bitboard_set_bit(&context->stable_check, size * (size - 1));
+  bitboard_set_bit(&context->stable_check, (size * size) - 1);
+
+  context->avx2 = false;
+  context->avx512_popcount = false;
+  context->bmi2 = false;
+  context->popcnt = false;
+#ifdef BOARD_AVX2
+  __builtin_cpu_init();
+  context->avx2 = (context->words == 1) && __builtin_cpu_supports("avx2");
+  context->avx512_popcount = context->avx2 &&
+    __builtin_cpu_supports("avx512vl") &&
+    __builtin_cpu_supports("avx512vpopcntdq");
+  context->bmi2 = context->avx2 && __builtin_cpu_supports("bmi2");
+  context->popcnt = context->avx2 && __builtin_cpu_supports("popcnt");
+#endif
+  for(int i = 0; i < 4; i++){
+    context->shift_64[i] = context->shift[i];
+    context->right_mask_64[i] = context->right_mask[i].word[0];
+    context->left_mask_64[i] = context->left_mask[i].word[0];
+  }
+
+  for(int i = 0; i < 8; i++){
+    context->regions[i] = BITBOARD_ZERO;
+  }
+  if(size == 8){
+    for(size_t row = 0; row < size; row++){
+      for(size_t column = 0; column < size; column++){
+        bitboard_set_bit(&context->regions[regions_8[row][column]],
+          (size * row) + column);
+      }
     }
   }
-  board = board & masc;
-  return board;
 }
 
-static bitboard_t shift_nw(const size_t size, const bitboard_t bitboard){
-  bitboard_t board = shift_north(size, bitboard);
-  board = shift_west(size, board);
-  return board;
+static void contexts_init(void){
+  for(size_t size = MIN_BOARD_SIZE; size <= MAX_BOARD_SIZE; size += 2){
+    context_init(&contexts[(size / 2) - 1], size);
+  }
 }
 
-static bitboard_t shift_sw(const size_t size, const bitboard_t bitboard){
-  bitboard_t board = shift_south(size, bitboard);
-  board = shift_west(size, board);
-  return board;
+/* returns the shared context of a (valid) board size */
+static const board_context_t *board_context(const size_t size){
+  pthread_once(&contexts_once, contexts_init);
+  return &contexts[(size / 2) - 1];
 }
 
-static bitboard_t shift_se(const size_t size, const bitboard_t bitboard){
-  bitboard_t board = shift_south(size, bitboard);
-  board = shift_east(size, board);
-  return board;
+/* shifts a bitboard of the given number of words one cell into the
+ * direction d: north, south, west, east, ne, nw, se, sw */
+__attribute__((always_inline))
+static inline bitboard_t context_shift(const board_context_t *context,
+  const int d, const bitboard_t bitboard, const size_t words){
+  switch (d){
+    case 0:
+      return bitboard_and(bitboard_shift_right(bitboard, context->shift[0],
+        words), context->right_mask[0], words);
+    case 1:
+      return bitboard_and(bitboard_shift_left(bitboard, context->shift[0],
+        words), context->left_mask[0], words);
+    case 2:
+      return bitboard_and(bitboard_shift_right(bitboard, context->shift[1],
+        words), context->right_mask[1], words);
+    case 3:
+      return bitboard_and(bitboard_shift_left(bitboard, context->shift[1],
+        words), context->left_mask[1], words);
+    case 4:
+      return bitboard_and(bitboard_shift_right(bitboard, context->shift[2],
+        words), context->right_mask[2], words);
+    case 5:
+      return bitboard_and(bitboard_shift_right(bitboard, context->shift[3],
+        words), context->right_mask[3], words);
+    case 6:
+      return bitboard_and(bitboard_shift_left(bitboard, context->shift[3],
+        words), context->left_mask[3], words);
+    default:
+      return bitboard_and(bitboard_shift_left(bitboard, context->shift[2],
+        words), context->left_mask[2], words);
+  }
 }
 
-static bitboard_t shift_ne(const size_t size, const bitboard_t bitboard){
-  bitboard_t board = shift_north(size, bitboard);
-  board = shift_east(size, board);
-  return board;
+#ifdef BOARD_AVX2
+/* AVX2 versions of compute_moves and compute_flips for boards up to 8x8:
+ * every 64 bits lane of a vector follows one of the 4 right (or left)
+ * directions, so the 8 directions are filled in parallel */
+
+__attribute__((target("avx2")))
+static uint64_t avx2_or_lanes(const __m256i vector){
+  __m128i half = _mm_or_si128(_mm256_castsi256_si128(vector),
+    _mm256_extracti128_si256(vector, 1));
+  half = _mm_or_si128(half, _mm_unpackhi_epi64(half, half));
+  return (uint64_t) _mm_cvtsi128_si64(half);
 }
 
-static bitboard_t (*shift_direction[8])
-(const size_t size, const bitboard_t bitboard);
-
-bitboard_t bitboard_1;
-bitboard_t bitboard_2;
-bitboard_t bitboard_3;
-bitboard_t bitboard_4;
-bitboard_t bitboard_5;
-bitboard_t bitboard_6;
-bitboard_t bitboard_7;
-bitboard_t bitboard_8;
-bitboard_t stable_check;
-
-/* from https://www.playingwithpointers.com/blog/swar.html */
-static size_t pop_cnt_64(bitboard_t i){
-  i = i - ((i >> 1) & 0x5555555555555555);
-  i = (i & 0x3333333333333333) + ((i >> 2) & 0x3333333333333333);
-  i = (((i + (i >> 4)) & 0x0F0F0F0F0F0F0F0F) *
-          0x0101010101010101);
-  bitboard_t masc = 0;
-  masc = ~masc;
-  masc = masc >> 64;
-  i = i & masc;
-  return i >> 56;
-}
-
-static size_t bitboard_popcount(const bitboard_t bitboard){
-  if(bitboard == 0){
-    return 0;
+__attribute__((target("avx2")))
+static uint64_t avx2_and_lanes(const __m256i vector){
+  __m128i half = _mm_and_si128(_mm256_castsi256_si128(vector),
+    _mm256_extracti128_si256(vector, 1));
+  half = _mm_and_si128(half, _mm_unpackhi_epi64(half, half));
+  return (uint64_t) _mm_cvtsi128_si64(half);
+}
+
+__attribute__((target("avx2")))
+static uint64_t compute_moves_avx2(const board_context_t *context,
+  const uint64_t player, const uint64_t opponent){
+  const __m256i shift = _mm256_loadu_si256((const __m256i *)
+    context->shift_64);
+  const __m256i right_mask = _mm256_loadu_si256((const __m256i *)
+    context->right_mask_64);
+  const __m256i left_mask = _mm256_loadu_si256((const __m256i *)
+    context->left_mask_64);
+  const __m256i p = _mm256_set1_epi64x((long long) player);
+  const __m256i o = _mm256_set1_epi64x((long long) opponent);
+  const __m256i right_line = _mm256_and_si256(o, right_mask);
+  const __m256i left_line = _mm256_and_si256(o, left_mask);
+  __m256i right = _mm256_and_si256(right_line, _mm256_srlv_epi64(p, shift));
+  __m256i left = _mm256_and_si256(left_line, _mm256_sllv_epi64(p, shift));
+  for(size_t i = 3; i < context->size; i++){
+    right = _mm256_or_si256(right,
+      _mm256_and_si256(right_line, _mm256_srlv_epi64(right, shift)));
+    left = _mm256_or_si256(left,
+      _mm256_and_si256(left_line, _mm256_sllv_epi64(left, shift)));
   }
-  bitboard_t count = bitboard;
-  bitboard_t masc = 0;
-  masc = ~masc;
-  masc = masc >> 64;
-  count = count & masc;
-  size_t a = pop_cnt_64(count);
-  count = bitboard;
-  count = count >> 64;
-  size_t b = pop_cnt_64(count);
-  return a + b;
-}
-
-static bitboard_t compute_moves(const size_t size, const bitboard_t player,
-  const bitboard_t opponent){
-  bitboard_t moves = 0;
-  for(int i = 0; i < 8; i++){
-    bitboard_t candidates;
-    candidates = opponent & ((*shift_direction[i]) (size, player));
-    while(bitboard_popcount(candidates) > 0){
-      moves = moves | ((~(player + opponent)) &
-      ((*shift_direction[i]) (size, candidates)));
-      candidates = opponent & ((*shift_direction[i]) (size, candidates));
+  __m256i moves = _mm256_or_si256(
+    _mm256_and_si256(right_mask, _mm256_srlv_epi64(right, shift)),
+    _mm256_and_si256(left_mask, _mm256_sllv_epi64(left, shift)));
+  return avx2_or_lanes(moves) & ~(player | opponent) &
+    context->full.word[0];
+}
+
+__attribute__((target("avx2")))
+static uint64_t compute_flips_avx2(const board_context_t *context,
+  const uint64_t move, const uint64_t player, const uint64_t opponent){
+  const __m256i shift = _mm256_loadu_si256((const __m256i *)
+    context->shift_64);
+  const __m256i right_mask = _mm256_loadu_si256((const __m256i *)
+    context->right_mask_64);
+  const __m256i left_mask = _mm256_loadu_si256((const __m256i *)
+    context->left_mask_64);
+  const __m256i m = _mm256_set1_epi64x((long long) move);
+  const __m256i p = _mm256_set1_epi64x((long long) player);
+  const __m256i o = _mm256_set1_epi64x((long long) opponent);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i right_line = _mm256_and_si256(o, right_mask);
+  const __m256i left_line = _mm256_and_si256(o, left_mask);
+  /* the opponent lines starting next to the move */
+  __m256i right = _mm256_and_si256(right_line, _mm256_srlv_epi64(m, shift));
+  __m256i left = _mm256_and_si256(left_line, _mm256_sllv_epi64(m, shift));
+  for(size_t i = 3; i < context->size; i++){
+    right = _mm256_or_si256(right,
+      _mm256_and_si256(right_line, _mm256_srlv_epi64(right, shift)));
+    left = _mm256_or_si256(left,
+      _mm256_and_si256(left_line, _mm256_sllv_epi64(left, shift)));
+  }
+  /* a line is flipped only if a player disc closes it */
+  __m256i right_end = _mm256_and_si256(_mm256_and_si256(p, right_mask),
+    _mm256_srlv_epi64(right, shift));
+  __m256i left_end = _mm256_and_si256(_mm256_and_si256(p, left_mask),
+    _mm256_sllv_epi64(left, shift));
+  right = _mm256_andnot_si256(_mm256_cmpeq_epi64(right_end, zero), right);
+  left = _mm256_andnot_si256(_mm256_cmpeq_epi64(left_end, zero), left);
+  return avx2_or_lanes(_mm256_or_si256(right, left));
+}
+#endif
+
+/* compute_moves for boards of the given number of words, inlined into
+ * one copy per number */
+__attribute__((always_inline))
+static inline bitboard_t compute_moves_words(const board_context_t *context,
+  const bitboard_t player, const bitboard_t opponent, const size_t words){
+#ifdef BOARD_AVX2
+  if(words == 1 && context->avx2){
+    bitboard_t moves = BITBOARD_ZERO;
+    moves.word[0] = compute_moves_avx2(context, player.word[0],
+      opponent.word[0]);
+    return moves;
+  }
+#endif
+  bitboard_t empty = bitboard_andnot(context->full,
+    bitboard_or(player, opponent, words), words);
+  bitboard_t moves = BITBOARD_ZERO;
+  for(int d = 0; d < 4; d++){
+    const unsigned shift = context->shift[d];
+    /* a line of opponent discs is at most size - 2 long */
+    bitboard_t right_line = bitboard_and(opponent, context->right_mask[d],
+      words);
+    bitboard_t left_line = bitboard_and(opponent, context->left_mask[d],
+      words);
+    bitboard_t right = bitboard_and(right_line,
+      bitboard_shift_right(player, shift, words), words);
+    bitboard_t left = bitboard_and(left_line,
+      bitboard_shift_left(player, shift, words), words);
+    for(size_t i = 3; i < context->size; i++){
+      right = bitboard_or(right, bitboard_and(right_line,
+        bitboard_shift_right(right, shift, words), words), words);
+      left = bitboard_or(left, bitboard_and(left_line,
+        bitboard_shift_left(left, shift, words), words), words);
     }
+    moves = bitboard_or(moves, bitboard_and(context->right_mask[d],
+      bitboard_shift_right(right, shift, words), words), words);
+    moves = bitboard_or(moves, bitboard_and(context->left_mask[d],
+      bitboard_shift_left(left, shift, words), words), words);
+  }
+  return bitboard_and(moves, empty, words);
+}
+
+static bitboard_t compute_moves(const board_context_t *context,
+  const bitboard_t player, const bitboard_t opponent){
+  switch (context->words){
+    case 1:
+      return compute_moves_words(context, player, opponent, 1);
+    case 2:
+      return compute_moves_words(context, player, opponent, 2);
+    case 3:
+      return compute_moves_words(context, player, opponent, 3);
+    default:
+      return compute_moves_words(context, player, opponent, BOARD_WORDS);
+  }
+}
+
+/* compute_flips for boards of the given number of words */
+__attribute__((always_inline))
+static inline bitboard_t compute_flips_words(const board_context_t *context,
+  const bitboard_t move, const bitboard_t player, const bitboard_t opponent,
+  const size_t words){
+#ifdef BOARD_AVX2
+  if(words == 1 && context->avx2){
+    bitboard_t flips = BITBOARD_ZERO;
+    flips.word[0] = compute_flips_avx2(context, move.word[0], player.word[0],
+      opponent.word[0]);
+    return flips;
+  }
+#endif
+  bitboard_t flips = BITBOARD_ZERO;
+  for(int d = 0; d < 4; d++){
+    const unsigned shift = context->shift[d];
+    const bitboard_t right_line = bitboard_and(opponent,
+      context->right_mask[d], words);
+    const bitboard_t left_line = bitboard_and(opponent,
+      context->left_mask[d], words);
+    bitboard_t line = BITBOARD_ZERO;
+    bitboard_t cell = bitboard_shift_right(move, shift, words);
+    while(!bitboard_is_zero(bitboard_and(cell, right_line, words), words)){
+      line = bitboard_or(line, cell, words);
+      cell = bitboard_shift_right(cell, shift, words);
+    }
+    if(!bitboard_is_zero(bitboard_and(bitboard_and(cell, player, words),
+      context->right_mask[d], words), words)){
+      flips = bitboard_or(flips, line, words);
+    }
+    line = BITBOARD_ZERO;
+    cell = bitboard_shift_left(move, shift, words);
+    while(!bitboard_is_zero(bitboard_and(cell, left_line, words), words)){
+      line = bitboard_or(line, cell, words);
+      cell = bitboard_shift_left(cell, shift, words);
+    }
+    if(!bitboard_is_zero(bitboard_and(bitboard_and(cell, player, words),
+      context->left_mask[d], words), words)){
+      flips = bitboard_or(flips, line, words);
+    }
+  }
+  return flips;
+}
+
+/* returns the discs flipped when player plays on the (single bit) move */
+static bitboard_t compute_flips(const board_context_t *context,
+  const bitboard_t move, const bitboard_t player, const bitboard_t opponent){
+  switch (context->words){
+    case 1:
+      return compute_flips_words(context, move, player, opponent, 1);
+    case 2:
+      return compute_flips_words(context, move, player, opponent, 2);
+    case 3:
+      return compute_flips_words(context, move, player, opponent, 3);
+    default:
+      return compute_flips_words(context, move, player, opponent,
+        BOARD_WORDS);
   }
-  bitboard_t masc = 1;
-  masc = masc << (size * size);
-  masc = masc - 1;
-  moves = moves & masc;
-  return moves;
 }
 
 static void update_moves(board_t *board){
@@ -165,17 +583,19 @@ static void update_moves(board_t *board){
     player = board->white;
     opponent = board->black;
   }
-  board->moves = compute_moves(board->size, player, opponent);
+  board->moves = compute_moves(board->context, player, opponent);
   board->next_move = board->moves;
 }
 
 size_t board_count_player_moves(board_t *board){
-  return bitboard_popcount(board->moves);
+  return bitboard_popcount(board->moves, board->context->words);
 }
 
 bool board_is_move_valid(const board_t *board, const move_t move){
-  bitboard_t moves = board->moves;
-  return ((moves >> ((board->size * move.row) + move.column)) & 0x1);
+  if(move.row >= board->size || move.column >= board->size){
+    return false;
+  }
+  return bitboard_test(board->moves, (board->size * move.row) + move.column);
 }
 
 static disc_t other_player(board_t *board){
@@ -189,7 +609,9 @@ static disc_t other_player(board_t *board){
 }
 
 bool board_stable_is_possible(board_t *board){
-  return (bitboard_popcount((board->white | board->black) & stable_check) > 0);
+  const size_t words = board->context->words;
+  return !bitboard_is_zero(bitboard_and(bitboard_or(board->white,
+    board->black, words), board->context->stable_check, words), words);
 }
 
 int board_evaluat_discs(board_t *board, disc_t player){
@@ -202,31 +624,15 @@ int board_evaluat_discs(board_t *board, disc_t player){
     player_bitboard = board->white;
     opponent_bitboard = board->black;
   }
+  const size_t words = board->context->words;
   int result = 0;
-  result += (bitboard_popcount(player_bitboard & bitboard_1) * 20);
-  result -= (bitboard_popcount(opponent_bitboard & bitboard_1) * 20);
-
-  result += (bitboard_popcount(player_bitboard & bitboard_2) * -3);
-  result -= (bitboard_popcount(opponent_bitboard & bitboard_2) * -3);
-
-  result += (bitboard_popcount(player_bitboard & bitboard_3) * 11);
-  result -= (bitboard_popcount(opponent_bitboard & bitboard_3) * 11);
-
-  result += (bitboard_popcount(player_bitboard & bitboard_4) * 8);
-  result -= (bitboard_popcount(opponent_bitboard & bitboard_4) * 8);
-
-  result += (bitboard_popcount(player_bitboard & bitboard_5) * -7);
-  result -= (bitboard_popcount(opponent_bitboard & bitboard_5) * -7);
-
-  result += (bitboard_popcount(player_bitboard & bitboard_6) * -4);
-  result -= (bitboard_popcount(opponent_bitboard & bitboard_6) * -4);
-
-  result += (bitboard_popcount(player_bitboard & bitboard_7) * 1);
-  result -= (bitboard_popcount(opponent_bitboard & bitboard_7) * 1);
-
-  result += (bitboard_popcount(player_bitboard & bitboard_8) * 2);
-  result -= (bitboard_popcount(opponent_bitboard & bitboard_8) * 2);
-
+  for(int i = 0; i < 8; i++){
+    bitboard_t region = board->context->regions[i];
+    result += (bitboard_popcount(bitboard_and(player_bitboard, region, words),
+      words) * region_values[i]);
+    result -= (bitboard_popcount(bitboard_and(opponent_bitboard, region,
+      words), words) * region_values[i]);
+  }
   return result;
 }
 
@@ -240,52 +646,91 @@ int board_mobility(board_t *board, disc_t player){
     player_bitboard = board->white;
     opponent_bitboard = board->black;
   }
-  size_t player_moves = bitboard_popcount(
-    compute_moves(board->size, player_bitboard, opponent_bitboard));
-  size_t opponent_moves = bitboard_popcount(
-    compute_moves(board->size, opponent_bitboard, player_bitboard));
+  const size_t words = board->context->words;
+  size_t player_moves = bitboard_popcount(compute_moves(board->context,
+    player_bitboard, opponent_bitboard), words);
+  size_t opponent_moves = bitboard_popcount(compute_moves(board->context,
+    opponent_bitboard, player_bitboard), words);
   return player_moves - opponent_moves;
 }
 
-static int board_frontiers_helper(board_t *board, disc_t player){
-  bitboard_t player_bitboard;
-  bitboard_t opponent_bitboard;
-  if(player == BLACK_DISC){
-    player_bitboard = board->black;
-    opponent_bitboard = board->white;
-  } else {
-    player_bitboard = board->white;
-    opponent_bitboard = board->black;
-  }
-  bitboard_t empty = ~(player_bitboard | opponent_bitboard);
-  bitboard_t frontiers = 0;
+/* frontier discs of player, compiled once per number of words */
+__attribute__((always_inline))
+static inline bitboard_t frontiers_words(const board_context_t *context,
+  const bitboard_t player, const bitboard_t opponent, const size_t words){
+  bitboard_t empty = bitboard_andnot(context->full,
+    bitboard_or(player, opponent, words), words);
+  bitboard_t frontiers = BITBOARD_ZERO;
   bitboard_t matched;
 
-  matched = empty & ((*shift_direction[0]) (board->size, player_bitboard));
-  frontiers |= (*shift_direction[1]) (board->size, matched);
-
-  matched = empty & ((*shift_direction[1]) (board->size, player_bitboard));
-  frontiers |= (*shift_direction[0]) (board->size, matched);
-
-  matched = empty & ((*shift_direction[2]) (board->size, player_bitboard));
-  frontiers |= (*shift_direction[3]) (board->size, matched);
-
-  matched = empty & ((*shift_direction[3]) (board->size, player_bitboard));
-  frontiers |= (*shift_direction[2]) (board->size, matched);
-
-  matched = empty & ((*shift_direction[4]) (board->size, player_bitboard));
-  frontiers |= (*shift_direction[7]) (board->size, matched);
-
-  matched = empty & ((*shift_direction[7]) (board->size, player_bitboard));
-  frontiers |= (*shift_direction[4]) (board->size, matched);
-
-  matched = empty & ((*shift_direction[5]) (board->size, player_bitboard));
-  frontiers |= (*shift_direction[6]) (board->size, matched);
+  matched = bitboard_and(empty, context_shift(context, 0, player, words),
+    words);
+  frontiers = bitboard_or(frontiers, context_shift(context, 1, matched,
+    words), words);
+
+  matched = bitboard_and(empty, context_shift(context, 1, player, words),
+    words);
+  frontiers = bitboard_or(frontiers, context_shift(context, 0, matched,
+    words), words);
+
+  matched = bitboard_and(empty, context_shift(context, 2, player, words),
+    words);
+  frontiers = bitboard_or(frontiers, context_shift(context, 3, matched,
+    words), words);
+
+  matched = bitboard_and(empty, context_shift(context, 3, player, words),
+    words);
+  frontiers = bitboard_or(frontiers, context_shift(context, 2, matched,
+    words), words);
+
+  matched = bitboard_and(empty, context_shift(context, 4, player, words),
+    words);
+  frontiers = bitboard_or(frontiers, context_shift(context, 7, matched,
+    words), words);
+
+  matched = bitboard_and(empty, context_shift(context, 7, player, words),
+    words);
+  frontiers = bitboard_or(frontiers, context_shift(context, 4, matched,
+    words), words);
+
+  matched = bitboard_and(empty, context_shift(context, 5, player, words),
+    words);
+  frontiers = bitboard_or(frontiers, context_shift(context, 6, matched,
+    words), words);
+
+  matched = bitboard_and(empty, context_shift(context, 6, player, words),
+    words);
+  frontiers = bitboard_or(frontiers, context_shift(context, 5, matched,
+    words), words);
+
+  return frontiers;
+}
 
-  matched = empty & ((*shift_direction[6]) (board->size, player_bitboard));
-  frontiers |= (*shift_direction[5]) (board->size, matched);
+/* number of frontier discs of player */
+static size_t frontiers_count(const board_context_t *context,
+  const bitboard_t player, const bitboard_t opponent){
+  bitboard_t frontiers;
+  switch (context->words){
+    case 1:
+      frontiers = frontiers_words(context, player, opponent, 1);
+      break;
+    case 2:
+      frontiers = frontiers_words(context, player, opponent, 2);
+      break;
+    case 3:
+      frontiers = frontiers_words(context, player, opponent, 3);
+      break;
+    default:
+      frontiers = frontiers_words(context, player, opponent, BOARD_WORDS);
+  }
+  return bitboard_popcount(frontiers, context->words);
+}
 
-  return bitboard_popcount(frontiers);
+static int board_frontiers_helper(board_t *board, disc_t player){
+  if(player == BLACK_DISC){
+    return frontiers_count(board->context, board->black, board->white);
+  }
+  return frontiers_count(board->context, board->white, board->black);
 }
 
 int board_frontiers(board_t *board, disc_t player){
@@ -300,108 +745,657 @@ int board_frontiers(board_t *board, disc_t player){
   return -(my_frontiers - opponent_frontiers);
 }
 
-static void board_compute_stable_pieces_helper(board_t *board,
-  size_t size, bool black){
-  bitboard_t player;
+/* Features of a position coming from the neighbours and the lines of its
+ * discs, for the player to move (index 0) and the opponent (1): the moves,
+ * the potential moves (empty squares next to a disc of the other side)
+ * and the frontier discs (next to an empty square) */
+typedef struct
+{
+  bitboard_t moves[2];
+  bitboard_t potential[2];
+  bitboard_t frontiers[2];
+  bitboard_t empty;
+} fills_t;
+
+/* computes the fills of a position of the given number of words from a
+ * single set of shifts: every direction shifts the discs of both sides and
+ * the empty squares once, which give the neighbours of each and start the
+ * lines of both sides' moves. The moves of the player are left out unless
+ * player_moves is set, a search node already has them */
+__attribute__((always_inline))
+static inline void fills_words(const board_context_t *context,
+  const bitboard_t player, const bitboard_t opponent, const bool player_moves,
+  fills_t *fills, const size_t words){
+  const bitboard_t empty = bitboard_andnot(context->full,
+    bitboard_or(player, opponent, words), words);
+  bitboard_t moves[2] = { BITBOARD_ZERO, BITBOARD_ZERO };
+  bitboard_t next_to_empty = BITBOARD_ZERO;
+  bitboard_t next_to_player = BITBOARD_ZERO;
+  bitboard_t next_to_opponent = BITBOARD_ZERO;
+  for(int d = 0; d < 4; d++){
+    const unsigned shift = context->shift[d];
+    const bitboard_t right_mask = context->right_mask[d];
+    const bitboard_t left_mask = context->left_mask[d];
+    const bitboard_t player_right = bitboard_and(right_mask,
+      bitboard_shift_right(player, shift, words), words);
+    const bitboard_t player_left = bitboard_and(left_mask,
+      bitboard_shift_left(player, shift, words), words);
+    const bitboard_t opponent_right = bitboard_and(right_mask,
+      bitboard_shift_right(opponent, shift, words), words);
+    const bitboard_t opponent_left = bitboard_and(left_mask,
+      bitboard_shift_left(opponent, shift, words), words);
+    next_to_empty = bitboard_or(next_to_empty, bitboard_or(
+      bitboard_and(right_mask, bitboard_shift_right(empty, shift, words),
+      words), bitboard_and(left_mask, bitboard_shift_left(empty, shift,
+      words), words), words), words);
+    next_to_player = bitboard_or(next_to_player, bitboard_or(player_right,
+      player_left, words), words);
+    next_to_opponent = bitboard_or(next_to_opponent,
+      bitboard_or(opponent_right, opponent_left, words), words);
+    /* lines of player discs from an opponent disc, then the other way
+     * round, a line is at most size - 2 long */
+    const bitboard_t player_right_line = bitboard_and(player, right_mask,
+      words);
+    const bitboard_t player_left_line = bitboard_and(player, left_mask,
+      words);
+    bitboard_t right = bitboard_and(player, opponent_right, words);
+    bitboard_t left = bitboard_and(player, opponent_left, words);
+    for(size_t i = 3; i < context->size; i++){
+      right = bitboard_or(right, bitboard_and(player_right_line,
+        bitboard_shift_right(right, shift, words), words), words);
+      left = bitboard_or(left, bitboard_and(player_left_line,
+        bitboard_shift_left(left, shift, words), words), words);
+    }
+    moves[1] = bitboard_or(moves[1], bitboard_or(bitboard_and(right_mask,
+      bitboard_shift_right(right, shift, words), words), bitboard_and(
+      left_mask, bitboard_shift_left(left, shift, words), words), words),
+      words);
+    if(player_moves){
+      const bitboard_t opponent_right_line = bitboard_and(opponent,
+        right_mask, words);
+      const bitboard_t opponent_left_line = bitboard_and(opponent, left_mask,
+        words);
+      right = bitboard_and(opponent, player_right, words);
+      left = bitboard_and(opponent, player_left, words);
+      for(size_t i = 3; i < context->size; i++){
+        right = bitboard_or(right, bitboard_and(opponent_right_line,
+          bitboard_shift_right(right, shift, words), words), words);
+        left = bitboard_or(left, bitboard_and(opponent_left_line,
+          bitboard_shift_left(left, shift, words), words), words);
+      }
+      moves[0] = bitboard_or(moves[0], bitboard_or(bitboard_and(right_mask,
+        bitboard_shift_right(right, shift, words), words), bitboard_and(
+        left_mask, bitboard_shift_left(left, shift, words), words), words),
+        words);
+    }
+  }
+  fills->moves[0] = bitboard_and(moves[0], empty, words);
+  fills->moves[1] = bitboard_and(moves[1], empty, words);
+  fills->potential[0] = bitboard_and(empty, next_to_opponent, words);
+  fills->potential[1] = bitboard_and(empty, next_to_player, words);
+  fills->frontiers[0] = bitboard_and(player, next_to_empty, words);
+  fills->frontiers[1] = bitboard_and(opponent, next_to_empty, words);
+  fills->empty = empty;
+}
+
+#ifdef BOARD_AVX2
+/* fills_words of a 64 bits board, the 4 lanes hold the 4 directions as in
+ * compute_moves_avx2 */
+__attribute__((target("avx2")))
+static void fills_avx2(const board_context_t *context, const uint64_t player,
+  const uint64_t opponent, const bool player_moves, fills_t *fills){
+  const __m256i shift = _mm256_loadu_si256((const __m256i *)
+    context->shift_64);
+  const __m256i right_mask = _mm256_loadu_si256((const __m256i *)
+    context->right_mask_64);
+  const __m256i left_mask = _mm256_loadu_si256((const __m256i *)
+    context->left_mask_64);
+  const uint64_t empty = ~(player | opponent) & context->full.word[0];
+  const __m256i p = _mm256_set1_epi64x((long long) player);
+  const __m256i o = _mm256_set1_epi64x((long long) opponent);
+  const __m256i e = _mm256_set1_epi64x((long long) empty);
+  const __m256i p_right = _mm256_and_si256(right_mask,
+    _mm256_srlv_epi64(p, shift));
+  const __m256i p_left = _mm256_and_si256(left_mask,
+    _mm256_sllv_epi64(p, shift));
+  const __m256i o_right = _mm256_and_si256(right_mask,
+    _mm256_srlv_epi64(o, shift));
+  const __m256i o_left = _mm256_and_si256(left_mask,
+    _mm256_sllv_epi64(o, shift));
+  const uint64_t next_to_empty = avx2_or_lanes(_mm256_or_si256(
+    _mm256_and_si256(right_mask, _mm256_srlv_epi64(e, shift)),
+    _mm256_and_si256(left_mask, _mm256_sllv_epi64(e, shift))));
+  const uint64_t next_to_player = avx2_or_lanes(_mm256_or_si256(p_right,
+    p_left));
+  const uint64_t next_to_opponent = avx2_or_lanes(_mm256_or_si256(o_right,
+    o_left));
+  const __m256i o_right_line = _mm256_and_si256(o, right_mask);
+  const __m256i o_left_line = _mm256_and_si256(o, left_mask);
+  const __m256i p_right_line = _mm256_and_si256(p, right_mask);
+  const __m256i p_left_line = _mm256_and_si256(p, left_mask);
+  __m256i right[2];
+  __m256i left[2];
+  right[0] = _mm256_and_si256(o, p_right);
+  left[0] = _mm256_and_si256(o, p_left);
+  right[1] = _mm256_and_si256(p, o_right);
+  left[1] = _mm256_and_si256(p, o_left);
+  for(size_t i = 3; i < context->size; i++){
+    if(player_moves){
+      right[0] = _mm256_or_si256(right[0], _mm256_and_si256(o_right_line,
+        _mm256_srlv_epi64(right[0], shift)));
+      left[0] = _mm256_or_si256(left[0], _mm256_and_si256(o_left_line,
+        _mm256_sllv_epi64(left[0], shift)));
+    }
+    right[1] = _mm256_or_si256(right[1], _mm256_and_si256(p_right_line,
+      _mm256_srlv_epi64(right[1], shift)));
+    left[1] = _mm256_or_si256(left[1], _mm256_and_si256(p_left_line,
+      _mm256_sllv_epi64(left[1], shift)));
+  }
+  for(int side = 0; side < 2; side++){
+    fills->moves[side] = BITBOARD_ZERO;
+    if(side == 1 || player_moves){
+      fills->moves[side].word[0] = avx2_or_lanes(_mm256_or_si256(
+        _mm256_and_si256(right_mask, _mm256_srlv_epi64(right[side], shift)),
+        _mm256_and_si256(left_mask, _mm256_sllv_epi64(left[side], shift)))) &
+        empty;
+    }
+  }
+  fills->potential[0] = BITBOARD_ZERO;
+  fills->potential[0].word[0] = empty & next_to_opponent;
+  fills->potential[1] = BITBOARD_ZERO;
+  fills->potential[1].word[0] = empty & next_to_player;
+  fills->frontiers[0] = BITBOARD_ZERO;
+  fills->frontiers[0].word[0] = player & next_to_empty;
+  fills->frontiers[1] = BITBOARD_ZERO;
+  fills->frontiers[1].word[0] = opponent & next_to_empty;
+  fills->empty = BITBOARD_ZERO;
+  fills->empty.word[0] = empty;
+}
+#endif
+
+static void fills_compute(const board_context_t *context,
+  const bitboard_t player, const bitboard_t opponent, const bool player_moves,
+  fills_t *fills){
+  switch (context->words){
+    case 1:
+#ifdef BOARD_AVX2
+      if(context->avx2){
+        fills_avx2(context, player.word[0], opponent.word[0], player_moves,
+          fills);
+        return;
+      }
+#endif
+      fills_words(context, player, opponent, player_moves, fills, 1);
+      return;
+    case 2:
+      fills_words(context, player, opponent, player_moves, fills, 2);
+      return;
+    case 3:
+      fills_words(context, player, opponent, player_moves, fills, 3);
+      return;
+    default:
+      fills_words(context, player, opponent, player_moves, fills,
+        BOARD_WORDS);
+  }
+}
+
+/* quadrants of the board with an odd number of empty squares */
+__attribute__((always_inline))
+static inline int odd_quadrants(const board_context_t *context,
+  const bitboard_t empty, const size_t words){
+  int odd = 0;
+  for(int q = 0; q < 4; q++){
+    odd += bitboard_popcount(bitboard_and(empty, context->quadrants[q],
+      words), words) & 1;
+  }
+  return odd;
+}
+
+/* fills_features for boards of the given number of words */
+__attribute__((always_inline))
+static inline void fills_features_words(const board_context_t *context,
+  const fills_t *fills, const bitboard_t player_moves, const bool to_move,
+  board_features_t *features, const size_t words){
+  features->mobility = (int) bitboard_popcount(player_moves, words) -
+    (int) bitboard_popcount(fills->moves[1], words);
+  features->potential_mobility = (int) bitboard_popcount(fills->potential[0],
+    words) - (int) bitboard_popcount(fills->potential[1], words);
+  features->frontiers = (int) bitboard_popcount(fills->frontiers[1], words) -
+    (int) bitboard_popcount(fills->frontiers[0], words);
+  const int parity = odd_quadrants(context, fills->empty, words);
+  features->parity = to_move ? parity : -parity;
+}
+
+/* sets the mobility (player_moves being the moves of the player), the
+ * potential mobility, the frontiers and the parity features from fills,
+ * the parity counts for the player if to_move is set and against it
+ * otherwise */
+static void fills_features(const board_context_t *context,
+  const fills_t *fills, const bitboard_t player_moves, const bool to_move,
+  board_features_t *features){
+  switch (context->words){
+    case 1:
+      fills_features_words(context, fills, player_moves, to_move, features,
+        1);
+      return;
+    case 2:
+      fills_features_words(context, fills, player_moves, to_move, features,
+        2);
+      return;
+    case 3:
+      fills_features_words(context, fills, player_moves, to_move, features,
+        3);
+      return;
+    default:
+      fills_features_words(context, fills, player_moves, to_move, features,
+        BOARD_WORDS);
+  }
+}
+
+/* discs of player which are maybe stable given the stable ones, compiled
+ * once per number of words */
+__attribute__((always_inline))
+static inline bitboard_t stable_words(const board_context_t *context,
+  const bitboard_t player, const bitboard_t stable, const size_t words){
   bitboard_t direction_1;
   bitboard_t direction_2;
   bitboard_t maybe_stable;
-  bitboard_t stable;
-  if(black){
-    stable = board->stable_black;
-    player = board->black;
-  } else {
-    stable = board->stable_white;
-    player = board->white;
-  }
-  direction_1 = ((*shift_direction[0]) (size, player));
-  direction_1 = direction_1 & ~(direction_1 & stable);
-  direction_1 = ((*shift_direction[1]) (size, direction_1));
-  direction_1 = direction_1 ^ player;
-
-  direction_2 = ((*shift_direction[1]) (size, player));
-  direction_2 = direction_2 & ~(direction_2 & stable);
-  direction_2 = ((*shift_direction[0]) (size, direction_2));
-  direction_2 = direction_2 ^ player;
-  maybe_stable = direction_1 | direction_2;
-
-  direction_1 = ((*shift_direction[2]) (size, player));
-  direction_1 = direction_1 & ~(direction_1 & stable);
-  direction_1 = ((*shift_direction[3]) (size, direction_1));
-  direction_1 = direction_1 ^ player;
-
-  direction_2 = ((*shift_direction[3]) (size, player));
-  direction_2 = direction_2 & ~(direction_2 & stable);
-  direction_2 = ((*shift_direction[2]) (size, direction_2));
-  direction_2 = direction_2 ^ player;
-  maybe_stable = maybe_stable & (direction_1 | direction_2);
-
-  direction_1 = ((*shift_direction[4]) (size, player));
-  direction_1 = direction_1 & ~(direction_1 & stable);
-  direction_1 = ((*shift_direction[7]) (size, direction_1));
-  direction_1 = direction_1 ^ player;
-
-  direction_2 = ((*shift_direction[7]) (size, player));
-  direction_2 = direction_2 & ~(direction_2 & stable);
-  direction_2 = ((*shift_direction[4]) (size, direction_2));
-  direction_2 = direction_2 ^ player;
-  maybe_stable = maybe_stable & (direction_1 | direction_2);
-
-  direction_1 = ((*shift_direction[5]) (size, player));
-  direction_1 = direction_1 & ~(direction_1 & stable);
-  direction_1 = ((*shift_direction[6]) (size, direction_1));
-  direction_1 = direction_1 ^ player;
-
-  direction_2 = ((*shift_direction[6]) (size, player));
-  direction_2 = direction_2 & ~(direction_2 & stable);
-  direction_2 = ((*shift_direction[5]) (size, direction_2));
-  direction_2 = direction_2 ^ player;
-  maybe_stable = maybe_stable & (direction_1 | direction_2);
-
-  if(black){
-    board->stable_black = board->stable_black | maybe_stable;
-  } else {
-    board->stable_white = board->stable_black | maybe_stable;
-  }
+  direction_1 = context_shift(context, 0, player, words);
+  direction_1 = bitboard_andnot(direction_1, stable, words);
+  direction_1 = context_shift(context, 1, direction_1, words);
+  direction_1 = bitboard_xor(direction_1, player, words);
+
+  direction_2 = context_shift(context, 1, player, words);
+  direction_2 = bitboard_andnot(direction_2, stable, words);
+  direction_2 = context_shift(context, 0, direction_2, words);
+  direction_2 = bitboard_xor(direction_2, player, words);
+  maybe_stable = bitboard_or(direction_1, direction_2, words);
+
+  direction_1 = context_shift(context, 2, player, words);
+  direction_1 = bitboard_andnot(direction_1, stable, words);
+  direction_1 = context_shift(context, 3, direction_1, words);
+  direction_1 = bitboard_xor(direction_1, player, words);
+
+  direction_2 = context_shift(context, 3, player, words);
+  direction_2 = bitboard_andnot(direction_2, stable, words);
+  direction_2 = context_shift(context, 2, direction_2, words);
+  direction_2 = bitboard_xor(direction_2, player, words);
+  maybe_stable = bitboard_and(maybe_stable,
+    bitboard_or(direction_1, direction_2, words), words);
+
+  direction_1 = context_shift(context, 4, player, words);
+  direction_1 = bitboard_andnot(direction_1, stable, words);
+  direction_1 = context_shift(context, 7, direction_1, words);
+  direction_1 = bitboard_xor(direction_1, player, words);
+
+  direction_2 = context_shift(context, 7, player, words);
+  direction_2 = bitboard_andnot(direction_2, stable, words);
+  direction_2 = context_shift(context, 4, direction_2, words);
+  direction_2 = bitboard_xor(direction_2, player, words);
+  maybe_stable = bitboard_and(maybe_stable,
+    bitboard_or(direction_1, direction_2, words), words);
+
+  direction_1 = context_shift(context, 5, player, words);
+  direction_1 = bitboard_andnot(direction_1, stable, words);
+  direction_1 = context_shift(context, 6, direction_1, words);
+  direction_1 = bitboard_xor(direction_1, player, words);
+
+  direction_2 = context_shift(context, 6, player, words);
+  direction_2 = bitboard_andnot(direction_2, stable, words);
+  direction_2 = context_shift(context, 5, direction_2, words);
+  direction_2 = bitboard_xor(direction_2, player, words);
+  maybe_stable = bitboard_and(maybe_stable,
+    bitboard_or(direction_1, direction_2, words), words);
+  return maybe_stable;
 }
 
-void board_compute_stable_pieces(board_t *board){
-  bool condition = true;
-  bitboard_t check = board->stable_black;
-  while(condition){
-    board_compute_stable_pieces_helper(board, board->size, true);
-    if(check == board->stable_black){
-      condition = false;
-    } else {
-      check = board->stable_black;
+#ifdef BOARD_AVX2
+/* AVX2 version of stable_discs for boards up to 8x8: every lane follows
+ * one of the 4 lines through a disc, in both of its directions, so one
+ * round of growth is 2 shifts of a vector instead of 16 of a word */
+__attribute__((target("avx2")))
+static uint64_t stable_discs_avx2(const board_context_t *context,
+  const uint64_t player, uint64_t stable){
+  const __m256i shift = _mm256_loadu_si256((const __m256i *)
+    context->shift_64);
+  const __m256i right_mask = _mm256_loadu_si256((const __m256i *)
+    context->right_mask_64);
+  const __m256i left_mask = _mm256_loadu_si256((const __m256i *)
+    context->left_mask_64);
+  const __m256i p = _mm256_set1_epi64x((long long) player);
+  const __m256i right = _mm256_and_si256(right_mask,
+    _mm256_srlv_epi64(p, shift));
+  const __m256i left = _mm256_and_si256(left_mask,
+    _mm256_sllv_epi64(p, shift));
+  while(true){
+    const __m256i s = _mm256_set1_epi64x((long long) stable);
+    const __m256i direction_1 = _mm256_xor_si256(p, _mm256_and_si256(
+      left_mask, _mm256_sllv_epi64(_mm256_andnot_si256(s, right), shift)));
+    const __m256i direction_2 = _mm256_xor_si256(p, _mm256_and_si256(
+      right_mask, _mm256_srlv_epi64(_mm256_andnot_si256(s, left), shift)));
+    const uint64_t grown = stable | avx2_and_lanes(_mm256_or_si256(
+      direction_1, direction_2));
+    if(grown == stable){
+      return stable;
     }
+    stable = grown;
   }
-  condition = true;
-  check = board->stable_white;
-  while(condition){
-    board_compute_stable_pieces_helper(board, board->size, false);
-    if(check == board->stable_white){
-      condition = false;
-    } else {
-      check = board->stable_white;
+}
+#endif
+
+/* grows the stable discs of player until no more disc is maybe stable */
+static bitboard_t stable_discs(const board_context_t *context,
+  const bitboard_t player, bitboard_t stable){
+  const size_t words = context->words;
+#ifdef BOARD_AVX2
+  if(words == 1 && context->avx2){
+    stable.word[0] = stable_discs_avx2(context, player.word[0],
+      stable.word[0]);
+    return stable;
+  }
+#endif
+  while(true){
+    bitboard_t maybe_stable;
+    switch (words){
+      case 1:
+        maybe_stable = stable_words(context, player, stable, 1);
+        break;
+      case 2:
+        maybe_stable = stable_words(context, player, stable, 2);
+        break;
+      case 3:
+        maybe_stable = stable_words(context, player, stable, 3);
+        break;
+      default:
+        maybe_stable = stable_words(context, player, stable, BOARD_WORDS);
+    }
+    const bitboard_t grown = bitboard_or(stable, maybe_stable, words);
+    if(bitboard_equal(grown, stable, words)){
+      return stable;
     }
+    stable = grown;
   }
 }
 
+void board_compute_stable_pieces(board_t *board){
+  board->stable_black = stable_discs(board->context, board->black,
+    board->stable_black);
+  board->stable_white = stable_discs(board->context, board->white,
+    board->stable_white);
+}
+
 int board_stable(board_t *board, disc_t player){
   board_compute_stable_pieces(board);
+  const size_t words = board->context->words;
   int my_stable;
   int opponent_stable;
   if(player == BLACK_DISC){
-    my_stable = bitboard_popcount(board->stable_black);
-    opponent_stable = bitboard_popcount(board->stable_white);
+    my_stable = bitboard_popcount(board->stable_black, words);
+    opponent_stable = bitboard_popcount(board->stable_white, words);
   } else {
-    my_stable = bitboard_popcount(board->stable_white);
-    opponent_stable = bitboard_popcount(board->stable_black);
+    my_stable = bitboard_popcount(board->stable_white, words);
+    opponent_stable = bitboard_popcount(board->stable_black, words);
   }
   return my_stable - opponent_stable;
 }
 
+void board_features(board_t *board, const disc_t player,
+  board_features_t *features){
+  score_t score = board_score(board);
+  if(player == BLACK_DISC){
+    features->score = score.black - score.white;
+  } else {
+    features->score = score.white - score.black;
+  }
+  features->stable = 0;
+  if(board_stable_is_possible(board)){
+    features->stable = board_stable(board, player);
+  }
+  bitboard_t player_bitboard = board->white;
+  bitboard_t opponent_bitboard = board->black;
+  if(player == BLACK_DISC){
+    player_bitboard = board->black;
+    opponent_bitboard = board->white;
+  }
+  const size_t words = board->context->words;
+  fills_t fills;
+  fills_compute(board->context, player_bitboard, opponent_bitboard, true,
+    &fills);
+  fills_features(board->context, &fills, fills.moves[0],
+    player == board->player, features);
+  features->disc_evaluation = 0;
+  for(int i = 0; i < 8; i++){
+    bitboard_t region = board->context->regions[i];
+    features->regions[i] = bitboard_popcount(bitboard_and(player_bitboard,
+      region, words), words) - bitboard_popcount(bitboard_and(
+      opponent_bitboard, region, words), words);
+    features->disc_evaluation += region_values[i] * features->regions[i];
+  }
+}
+
+#ifdef BOARD_AVX2
+/* Batch evaluation works on groups of 4 positions, one per 64 bits lane.
+ * The masks of all features are computed first, then counted in one go */
+#define FEATURE_GROUP 4
+#define FEATURE_MASKS 28
+
+enum {
+  MASK_PLAYER,
+  MASK_OPPONENT,
+  MASK_PLAYER_MOVES,
+  MASK_OPPONENT_MOVES,
+  MASK_PLAYER_FRONTIERS,
+  MASK_OPPONENT_FRONTIERS,
+  MASK_PLAYER_POTENTIAL,
+  MASK_OPPONENT_POTENTIAL,
+  /* then the empty squares of every quadrant */
+  MASK_QUADRANTS,
+  /* then player and opponent discs of every region */
+  MASK_REGIONS = MASK_QUADRANTS + 4
+};
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_shift(const board_context_t *context, const int d,
+  const bool right, const __m256i vector){
+  const __m128i count = _mm_cvtsi32_si128(context->shift_64[d]);
+  if(right){
+    return _mm256_and_si256(_mm256_srl_epi64(vector, count),
+      _mm256_set1_epi64x((long long) context->right_mask_64[d]));
+  }
+  return _mm256_and_si256(_mm256_sll_epi64(vector, count),
+    _mm256_set1_epi64x((long long) context->left_mask_64[d]));
+}
+
+__attribute__((target("avx2")))
+static __m256i avx2_moves_batch(const board_context_t *context,
+  const __m256i player, const __m256i opponent, const __m256i empty){
+  __m256i moves = _mm256_setzero_si256();
+  for(int d = 0; d < 8; d++){
+    const bool right = (d < 4);
+    __m256i line = _mm256_and_si256(opponent,
+      avx2_shift(context, d % 4, right, player));
+    for(size_t i = 3; i < context->size; i++){
+      line = _mm256_or_si256(line, _mm256_and_si256(opponent,
+        avx2_shift(context, d % 4, right, line)));
+    }
+    moves = _mm256_or_si256(moves, avx2_shift(context, d % 4, right, line));
+  }
+  return _mm256_and_si256(moves, empty);
+}
+
+/* writes the feature masks of 4 positions to masks[FEATURE_MASKS][4] */
+__attribute__((target("avx2")))
+static void avx2_feature_masks(const board_context_t *context,
+  const uint64_t player[FEATURE_GROUP], const uint64_t opponent[FEATURE_GROUP],
+  uint64_t masks[FEATURE_MASKS * FEATURE_GROUP]){
+  __m256i *out = (__m256i *) masks;
+  const __m256i p = _mm256_loadu_si256((const __m256i *) player);
+  const __m256i o = _mm256_loadu_si256((const __m256i *) opponent);
+  const __m256i empty = _mm256_andnot_si256(_mm256_or_si256(p, o),
+    _mm256_set1_epi64x((long long) context->full.word[0]));
+  _mm256_storeu_si256(&out[MASK_PLAYER], p);
+  _mm256_storeu_si256(&out[MASK_OPPONENT], o);
+  _mm256_storeu_si256(&out[MASK_PLAYER_MOVES],
+    avx2_moves_batch(context, p, o, empty));
+  _mm256_storeu_si256(&out[MASK_OPPONENT_MOVES],
+    avx2_moves_batch(context, o, p, empty));
+  /* cells next to an empty cell, a player disc and an opponent disc */
+  __m256i next_to_empty = _mm256_setzero_si256();
+  __m256i next_to_player = _mm256_setzero_si256();
+  __m256i next_to_opponent = _mm256_setzero_si256();
+  for(int d = 0; d < 8; d++){
+    const bool right = (d < 4);
+    next_to_empty = _mm256_or_si256(next_to_empty,
+      avx2_shift(context, d % 4, right, empty));
+    next_to_player = _mm256_or_si256(next_to_player,
+      avx2_shift(context, d % 4, right, p));
+    next_to_opponent = _mm256_or_si256(next_to_opponent,
+      avx2_shift(context, d % 4, right, o));
+  }
+  _mm256_storeu_si256(&out[MASK_PLAYER_FRONTIERS],
+    _mm256_and_si256(p, next_to_empty));
+  _mm256_storeu_si256(&out[MASK_OPPONENT_FRONTIERS],
+    _mm256_and_si256(o, next_to_empty));
+  _mm256_storeu_si256(&out[MASK_PLAYER_POTENTIAL],
+    _mm256_and_si256(empty, next_to_opponent));
+  _mm256_storeu_si256(&out[MASK_OPPONENT_POTENTIAL],
+    _mm256_and_si256(empty, next_to_player));
+  for(int q = 0; q < 4; q++){
+    _mm256_storeu_si256(&out[MASK_QUADRANTS + q], _mm256_and_si256(empty,
+      _mm256_set1_epi64x((long long) context->quadrants[q].word[0])));
+  }
+  for(int i = 0; i < 8; i++){
+    const __m256i region = _mm256_set1_epi64x((long long)
+      context->regions[i].word[0]);
+    _mm256_storeu_si256(&out[MASK_REGIONS + (2 * i)],
+      _mm256_and_si256(p, region));
+    _mm256_storeu_si256(&out[MASK_REGIONS + (2 * i) + 1],
+      _mm256_and_si256(o, region));
+  }
+}
+
+/* counts the bits of every word, with the nibble lookup table of
+ * Mula et al., the count of n words needs n % 4 == 0 */
+__attribute__((target("avx2")))
+static void avx2_popcount_words(const uint64_t *words, uint64_t *counts,
+  const size_t n){
+  const __m256i lookup = _mm256_setr_epi8(
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  for(size_t i = 0; i < n; i += 4){
+    const __m256i vector = _mm256_loadu_si256((const __m256i *) &words[i]);
+    const __m256i low = _mm256_and_si256(vector, low_mask);
+    const __m256i high = _mm256_and_si256(_mm256_srli_epi16(vector, 4),
+      low_mask);
+    const __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+      _mm256_shuffle_epi8(lookup, high));
+    _mm256_storeu_si256((__m256i *) &counts[i],
+      _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+  }
+}
+
+__attribute__((target("avx512f,avx512vl,avx512vpopcntdq")))
+static void avx512_popcount_words(const uint64_t *words, uint64_t *counts,
+  const size_t n){
+  for(size_t i = 0; i < n; i += 4){
+    const __m256i vector = _mm256_loadu_si256((const __m256i *) &words[i]);
+    _mm256_storeu_si256((__m256i *) &counts[i], _mm256_popcnt_epi64(vector));
+  }
+}
+
+/* computes the features of a group of up to FEATURE_GROUP positions but
+ * their stable discs, the parity is that of the player to move */
+static void avx2_features_group(const board_context_t *context,
+  const uint64_t player[FEATURE_GROUP], const uint64_t opponent[FEATURE_GROUP],
+  const size_t group, board_features_t features[]){
+  uint64_t masks[FEATURE_MASKS * FEATURE_GROUP];
+  uint64_t counts[FEATURE_MASKS * FEATURE_GROUP];
+  avx2_feature_masks(context, player, opponent, masks);
+  if(context->avx512_popcount){
+    avx512_popcount_words(masks, counts, FEATURE_MASKS * FEATURE_GROUP);
+  } else {
+    avx2_popcount_words(masks, counts, FEATURE_MASKS * FEATURE_GROUP);
+  }
+  for(size_t i = 0; i < group; i++){
+    const uint64_t *c = &counts[i];
+    board_features_t *result = &features[i];
+    result->score = (int) c[MASK_PLAYER * FEATURE_GROUP] -
+      (int) c[MASK_OPPONENT * FEATURE_GROUP];
+    result->mobility = (int) c[MASK_PLAYER_MOVES * FEATURE_GROUP] -
+      (int) c[MASK_OPPONENT_MOVES * FEATURE_GROUP];
+    result->frontiers = -((int) c[MASK_PLAYER_FRONTIERS * FEATURE_GROUP] -
+      (int) c[MASK_OPPONENT_FRONTIERS * FEATURE_GROUP]);
+    result->potential_mobility =
+      (int) c[MASK_PLAYER_POTENTIAL * FEATURE_GROUP] -
+      (int) c[MASK_OPPONENT_POTENTIAL * FEATURE_GROUP];
+    result->parity = 0;
+    for(int q = 0; q < 4; q++){
+      result->parity += c[(MASK_QUADRANTS + q) * FEATURE_GROUP] & 1;
+    }
+    result->disc_evaluation = 0;
+    for(int r = 0; r < 8; r++){
+      result->regions[r] =
+        (int) c[(MASK_REGIONS + (2 * r)) * FEATURE_GROUP] -
+        (int) c[(MASK_REGIONS + (2 * r) + 1) * FEATURE_GROUP];
+      result->disc_evaluation += region_values[r] * result->regions[r];
+    }
+  }
+}
+
+static void board_features_avx2(board_t *const boards[], const size_t count,
+  const disc_t player, board_features_t features[]){
+  const board_context_t *context = boards[0]->context;
+  for(size_t first = 0; first < count; first += FEATURE_GROUP){
+    uint64_t player_discs[FEATURE_GROUP] = { 0 };
+    uint64_t opponent_discs[FEATURE_GROUP] = { 0 };
+    size_t group = count - first;
+    if(group > FEATURE_GROUP){
+      group = FEATURE_GROUP;
+    }
+    for(size_t i = 0; i < group; i++){
+      const board_t *board = boards[first + i];
+      if(player == BLACK_DISC){
+        player_discs[i] = board->black.word[0];
+        opponent_discs[i] = board->white.word[0];
+      } else {
+        player_discs[i] = board->white.word[0];
+        opponent_discs[i] = board->black.word[0];
+      }
+    }
+    avx2_features_group(context, player_discs, opponent_discs, group,
+      &features[first]);
+    for(size_t i = 0; i < group; i++){
+      board_features_t *result = &features[first + i];
+      if(boards[first + i]->player != player){
+        result->parity = -result->parity;
+      }
+      /* stability is an iterative fix point, it stays scalar */
+      result->stable = 0;
+      if(board_stable_is_possible(boards[first + i])){
+        result->stable = board_stable(boards[first + i], player);
+      }
+    }
+  }
+}
+#endif
+
+void board_features_batch(board_t *const boards[], const size_t count,
+  const disc_t player, board_features_t features[]){
+  if(count == 0){
+    return;
+  }
+#ifdef BOARD_AVX2
+  if(boards[0]->context->avx2){
+    board_features_avx2(boards, count, player, features);
+    return;
+  }
+#endif
+  for(size_t i = 0; i < count; i++){
+    board_features(boards[i], player, &features[i]);
+  }
+}
+
 void board_check_end(board_t *board){
   if(board_count_player_moves(board) == 0){
     board_set_player(board, other_player(board));
@@ -413,21 +1407,21 @@ void board_check_end(board_t *board){
 }
 
 size_t turns_left(board_t *board){
-  size_t turn = bitboard_popcount(board->black) +
-    bitboard_popcount(board->white);
+  const size_t words = board->context->words;
+  size_t turn = bitboard_popcount(board->black, words) +
+    bitboard_popcount(board->white, words);
   size_t board_size = board->size * board->size;
   return board_size - turn;
 }
 
-game_stage stage_of_game(board_t *board){
-  size_t turn = bitboard_popcount(board->black) +
-    bitboard_popcount(board->white);
+/* stage of a game of the given size with discs on the board */
+static game_stage stage_of(const size_t size, const size_t discs){
   game_stage result;
-  if(turn <= (board->size * board->size) / 3){
+  if(discs <= (size * size) / 3){
     result = EARLY_GAME;
-  } else if(turn <= 2 * (board->size * board->size) / 3){
+  } else if(discs <= 2 * (size * size) / 3){
     result = MID_GAME;
-  } else if(turn <= (board->size * board->size) - 5){
+  } else if(discs <= (size * size) - 5){
     result = END_GAME;
   } else {
     result = END_END_GAME;
@@ -435,6 +1429,12 @@ game_stage stage_of_game(board_t *board){
   return result;
 }
 
+game_stage stage_of_game(board_t *board){
+  const size_t words = board->context->words;
+  return stage_of(board->size, bitboard_popcount(board->black, words) +
+    bitboard_popcount(board->white, words));
+}
+
 bool board_play(board_t *board, const move_t move){
   if(!board_is_move_valid(board, move)){
     return false;
@@ -443,9 +1443,10 @@ bool board_play(board_t *board, const move_t move){
     return false;
   }
 
+  const size_t words = board->context->words;
   bitboard_t player;
   bitboard_t opponent;
-  bitboard_t changes = 0;
+  bitboard_t changes;
   if(board->player == BLACK_DISC){
     player = board->black;
     opponent = board->white;
@@ -453,26 +1454,17 @@ bool board_play(board_t *board, const move_t move){
     player = board->white;
     opponent = board->black;
   }
-  board_set(board, board->player, move.row, move.column);
-  /*here the code where the pieces are turned around*/
-  for(int i = 0; i < 8; i++){
-    bitboard_t maybe_changes = 0;
-    bitboard_t maybe = ((*shift_direction[i])
-    (board->size, set_bitboard(board->size, move.row, move.column)));
-    while((maybe & opponent) != 0){
-      maybe_changes |= maybe;
-      maybe = ((*shift_direction[i]) (board->size, maybe));
-    }
-    if((maybe & player) != 0){
-      changes |= maybe_changes;
-    }
-  }
+  /* the disc of the move and the flipped ones, the moves are computed once
+   * for the next player */
+  const bitboard_t square = set_bitboard(board->size, move.row, move.column);
+  changes = bitboard_or(compute_flips(board->context, square, player,
+    opponent), square, words);
   if(board->player == BLACK_DISC){
-    board->black |= changes;
-    board->white &= ~changes;
+    board->black = bitboard_or(board->black, changes, words);
+    board->white = bitboard_andnot(board->white, changes, words);
   } else {
-    board->white |= changes;
-    board->black &= ~changes;
+    board->white = bitboard_or(board->white, changes, words);
+    board->black = bitboard_andnot(board->black, changes, words);
   }
   board_set_player(board, other_player(board));
   update_moves(board);
@@ -481,206 +1473,350 @@ bool board_play(board_t *board, const move_t move){
 }
 
 move_t board_next_move(board_t *board){
-  if(board->next_move == 0){
+  const size_t words = board->context->words;
+  if(bitboard_is_zero(board->next_move, words)){
     board->next_move = board->moves;
   }
-  bitboard_t next_move = board->next_move;
-  int last_bit = -1;
-
-  for(size_t i = 0; i < (board->size * board->size); i++){
-    if((next_move >> i) & 0x1){
-      last_bit = i;
-    }
-  }
+  int last_bit = bitboard_highest(board->next_move, words);
   if(last_bit == -1){
-    move_t empty = { .row = 11, .column = 11 };
+    move_t empty = { .row = MAX_BOARD_SIZE + 1,
+      .column = MAX_BOARD_SIZE + 1 };
     return empty;
   } else {
     size_t column = last_bit % board->size;
     size_t row = last_bit / board->size;
     move_t result = { .row = row, .column = column };
-    board->next_move =
-      board->next_move & ~(set_bitboard(board->size, 0, 0) << last_bit);
+    board->next_move = bitboard_andnot(board->next_move,
+      bitboard_bit(last_bit), words);
     return result;
   }
 }
 
-static void first_time_things(size_t size){
-  shift_direction[0] = shift_north;
-  shift_direction[1] = shift_south;
-  shift_direction[2] = shift_west;
-  shift_direction[3] = shift_east;
-  shift_direction[4] = shift_ne;
-  shift_direction[5] = shift_nw;
-  shift_direction[6] = shift_se;
-  shift_direction[7] = shift_sw;
-
-  /* stable_check serves to check if a stable piece is possible */
-  stable_check = 1;
-  stable_check = stable_check << (size - 1);
-  stable_check += 1;
-  stable_check = stable_check << (((size - 2) * size) + 1);
-  stable_check += 1;
-  stable_check = stable_check << (size - 1);
-  stable_check += 1;
-
-  /* the next couple of bitboards determin how good discs positions are.
-   * Only works for board size 8
-   * bitboard_1 has position 00, 07, 70, 77
-    * and those positions have value 20 */
-  bitboard_1 = 1;
-  bitboard_1 = bitboard_1 << 7;
-  bitboard_1 += 1;
-  bitboard_1 = bitboard_1 << 49;
-  bitboard_1 += 1;
-  bitboard_1 = bitboard_1 << 7;
-  bitboard_1 += 1;
-  /* bitboard_2 has position 01, 06, 10, 17, 33, 34, 43, 44, 60, 67, 71, 76
-   * and those positions have value -3 */
-  bitboard_2 = 1;
-  bitboard_2 = bitboard_2 << 5;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 2;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 7;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 12;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 1;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 7;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 1;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 12;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 7;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 2;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 5;
-  bitboard_2 += 1;
-  bitboard_2 = bitboard_2 << 1;
-  /* bitboard_3 has position 02, 05, 20, 27, 50, 57, 72, 75
-   * and those positions have value -3 */
-  bitboard_3 = 1;
-  bitboard_3 = bitboard_3 << 3;
-  bitboard_3 += 1;
-  bitboard_3 = bitboard_3 << 11;
-  bitboard_3 += 1;
-  bitboard_3 = bitboard_3 << 7;
-  bitboard_3 += 1;
-  bitboard_3 = bitboard_3 << 17;
-  bitboard_3 += 1;
-  bitboard_3 = bitboard_3 << 7;
-  bitboard_3 += 1;
-  bitboard_3 = bitboard_3 << 11;
-  bitboard_3 += 1;
-  bitboard_3 = bitboard_3 << 3;
-  bitboard_3 += 1;
-  bitboard_3 = bitboard_3 << 2;
-  /* bitboard_4 has position 03, 04, 30, 37, 40, 47, 73, 74
-   * and those positions have value 8 */
-  bitboard_4 = 1;
-  bitboard_4 = bitboard_4 << 1;
-  bitboard_4 += 1;
-  bitboard_4 = bitboard_4 << 20;
-  bitboard_4 += 1;
-  bitboard_4 = bitboard_4 << 7;
-  bitboard_4 += 1;
-  bitboard_4 = bitboard_4 << 1;
-  bitboard_4 += 1;
-  bitboard_4 = bitboard_4 << 7;
-  bitboard_4 += 1;
-  bitboard_4 = bitboard_4 << 20;
-  bitboard_4 += 1;
-  bitboard_4 = bitboard_4 << 1;
-  bitboard_4 += 1;
-  bitboard_4 = bitboard_4 << 3;
-  /* bitboard_5 has position 11, 16, 61, 66
-   * and those positions have value -7 */
-  bitboard_5 = 1;
-  bitboard_5 = bitboard_5 << 5;
-  bitboard_5 += 1;
-  bitboard_5 = bitboard_5 << 35;
-  bitboard_5 += 1;
-  bitboard_5 = bitboard_5 << 5;
-  bitboard_5 += 1;
-  bitboard_5 = bitboard_5 << 9;
-  /* bitboard_6 has position 12, 15, 21, 26, 51, 56, 62, 65
-   * and those positions have value -4 */
-  bitboard_6 = 1;
-  bitboard_6 = bitboard_6 << 3;
-  bitboard_6 += 1;
-  bitboard_6 = bitboard_6 << 4;
-  bitboard_6 += 1;
-  bitboard_6 = bitboard_6 << 5;
-  bitboard_6 += 1;
-  bitboard_6 = bitboard_6 << 19;
-  bitboard_6 += 1;
-  bitboard_6 = bitboard_6 << 5;
-  bitboard_6 += 1;
-  bitboard_6 = bitboard_6 << 4;
-  bitboard_6 += 1;
-  bitboard_6 = bitboard_6 << 3;
-  bitboard_6 += 1;
-  bitboard_6 = bitboard_6 << 10;
-  /* bitboard_7 has position 13, 14, 31, 36, 41, 46, 63, 64
-   * and those positions have value 1 */
-  bitboard_7 = 1;
-  bitboard_7 = bitboard_7 << 1;
-  bitboard_7 += 1;
-  bitboard_7 = bitboard_7 << 13;
-  bitboard_7 += 1;
-  bitboard_7 = bitboard_7 << 5;
-  bitboard_7 += 1;
-  bitboard_7 = bitboard_7 << 3;
-  bitboard_7 += 1;
-  bitboard_7 = bitboard_7 << 5;
-  bitboard_7 += 1;
-  bitboard_7 = bitboard_7 << 13;
-  bitboard_7 += 1;
-  bitboard_7 = bitboard_7 << 1;
-  bitboard_7 += 1;
-  bitboard_7 = bitboard_7 << 11;
-  /* bitboard_8 has position 22, 23, 24, 25, 32,
-   * 35, 42, 45, 52, 53, 54, 55
-   * and those positions have value 2 */
-  bitboard_8 = 15;
-  bitboard_8 = bitboard_8 << 5;
-  bitboard_8 += 1;
-  bitboard_8 = bitboard_8 << 3;
-  bitboard_8 += 1;
-  bitboard_8 = bitboard_8 << 5;
-  bitboard_8 += 1;
-  bitboard_8 = bitboard_8 << 3;
-  bitboard_8 += 1;
-  bitboard_8 = bitboard_8 << 8;
-  bitboard_8 += 15;
-  bitboard_8 = bitboard_8 << 18;
-}
-
-board_t *board_alloc(const size_t size, const disc_t player,
-  const bool first_time){
-  if(first_time){
-    /* first_time_things is called only once because of the variable
-     * first_time, which is only true in board_init and the file_parser.
-     * Not in board_copy. */
-    first_time_things(size);
+/* returns the index of the k-th (from 0) set bit of a 64 bit word with a
+ * popcount driven binary search, in a constant number of steps */
+static size_t select_64(uint64_t word, size_t k){
+  size_t index = 0;
+  for(int width = 32; width > 0; width >>= 1){
+    uint64_t low = word & ((1ULL << width) - 1);
+    size_t count = __builtin_popcountll(low);
+    if(k >= count){
+      k -= count;
+      word >>= width;
+      index += width;
+    } else {
+      word = low;
+    }
+  }
+  return index;
+}
+
+static size_t bitboard_select(const bitboard_t bitboard, size_t k,
+  const size_t words){
+  size_t i = 0;
+  for(; i + 1 < words && i + 1 < BOARD_WORDS; i++){
+    size_t count = __builtin_popcountll(bitboard.word[i]);
+    if(k < count){
+      break;
+    }
+    k -= count;
+  }
+  return (64 * i) + select_64(bitboard.word[i], k);
+}
+
+move_t board_random_move(const board_t *board){
+  const size_t words = board->context->words;
+  if(bitboard_is_zero(board->moves, words)){
+    move_t empty = { .row = MAX_BOARD_SIZE + 1,
+      .column = MAX_BOARD_SIZE + 1 };
+    return empty;
+  }
+  size_t k = rng_bounded(bitboard_popcount(board->moves, words));
+  size_t index = bitboard_select(board->moves, k, words);
+  move_t result = { .row = index / board->size,
+    .column = index % board->size };
+  return result;
+}
+
+/* returns a random set bit of a non empty bitboard, the select is
+ * unrolled for the word count like the other kernels */
+__attribute__((always_inline))
+static inline bitboard_t random_bit_words(const bitboard_t bitboard,
+  const size_t words){
+  size_t k = rng_bounded(bitboard_popcount(bitboard, words));
+  size_t i = 0;
+  for(; i + 1 < words && i + 1 < BOARD_WORDS; i++){
+    size_t count = __builtin_popcountll(bitboard.word[i]);
+    if(k < count){
+      break;
+    }
+    k -= count;
+  }
+  bitboard_t bit = BITBOARD_ZERO;
+  bit.word[i] = (uint64_t) 1 << select_64(bitboard.word[i], k);
+  return bit;
+}
+
+/* plays random moves until neither side can move, returns true if the
+ * sides were swapped an odd number of times */
+__attribute__((always_inline))
+static inline bool playout_words(const board_context_t *context,
+  bitboard_t *player_io, bitboard_t *opponent_io, const size_t words){
+  bitboard_t player = *player_io;
+  bitboard_t opponent = *opponent_io;
+  bool swapped = false;
+  bool passed = false;
+  while(true){
+    bitboard_t moves = compute_moves_words(context, player, opponent, words);
+    if(bitboard_is_zero(moves, words)){
+      if(passed){
+        break;
+      }
+      passed = true;
+    } else {
+      passed = false;
+      bitboard_t move = random_bit_words(moves, words);
+      bitboard_t flips = compute_flips_words(context, move, player, opponent,
+        words);
+      player = bitboard_or(player, bitboard_or(move, flips, words), words);
+      opponent = bitboard_andnot(opponent, flips, words);
+    }
+    bitboard_t tmp = player;
+    player = opponent;
+    opponent = tmp;
+    swapped = !swapped;
+  }
+  *player_io = player;
+  *opponent_io = opponent;
+  return swapped;
+}
+
+#ifdef BOARD_AVX2
+/* playout_words for boards of one word: the AVX2 kernels are inlined in
+ * the loop and pdep picks the k-th move without a select loop */
+__attribute__((target("avx2,bmi2")))
+static bool playout_avx2(const board_context_t *context,
+  bitboard_t *player_io, bitboard_t *opponent_io){
+  uint64_t player = player_io->word[0];
+  uint64_t opponent = opponent_io->word[0];
+  bool swapped = false;
+  bool passed = false;
+  while(true){
+    uint64_t moves = compute_moves_avx2(context, player, opponent);
+    if(moves == 0){
+      if(passed){
+        break;
+      }
+      passed = true;
+    } else {
+      passed = false;
+      uint64_t move = _pdep_u64(
+        (uint64_t) 1 << rng_bounded(__builtin_popcountll(moves)), moves);
+      uint64_t flips = compute_flips_avx2(context, move, player, opponent);
+      player |= move | flips;
+      opponent &= ~flips;
+    }
+    uint64_t tmp = player;
+    player = opponent;
+    opponent = tmp;
+    swapped = !swapped;
+  }
+  player_io->word[0] = player;
+  opponent_io->word[0] = opponent;
+  return swapped;
+}
+#endif
+
+static bool playout(const board_context_t *context, bitboard_t *player,
+  bitboard_t *opponent){
+#ifdef BOARD_AVX2
+  if(context->bmi2){
+    return playout_avx2(context, player, opponent);
+  }
+#endif
+  switch (context->words){
+    case 1:
+      return playout_words(context, player, opponent, 1);
+    case 2:
+      return playout_words(context, player, opponent, 2);
+    case 3:
+      return playout_words(context, player, opponent, 3);
+    default:
+      return playout_words(context, player, opponent, BOARD_WORDS);
+  }
+}
+
+score_t board_random_playout(const board_t *board){
+  const board_context_t *context = board->context;
+  const size_t words = context->words;
+  bitboard_t player;
+  bitboard_t opponent;
+  bool black_to_move = (board->player == BLACK_DISC);
+  if(black_to_move){
+    player = board->black;
+    opponent = board->white;
+  } else {
+    player = board->white;
+    opponent = board->black;
+  }
+  if(board->player != EMPTY_DISC){
+    bool swapped = playout(context, &player, &opponent);
+    if(swapped){
+      black_to_move = !black_to_move;
+    }
+  }
+  score_t score;
+  if(black_to_move){
+    score.black = bitboard_popcount(player, words);
+    score.white = bitboard_popcount(opponent, words);
+  } else {
+    score.black = bitboard_popcount(opponent, words);
+    score.white = bitboard_popcount(player, words);
+  }
+  return score;
+}
+
+/* longest line counted by perft, every ply fills a square or passes */
+#define PERFT_MAX_PLY (2 * MAX_BOARD_SIZE * MAX_BOARD_SIZE)
+
+/* A position of the line followed by perft */
+typedef struct
+{
+  bitboard_t player;
+  bitboard_t opponent;
+  /* moves left to count */
+  bitboard_t moves;
+  bool passed;
+} perft_ply_t;
+
+/* counts the leaves with an explicit stack of the line instead of
+ * recursion, so that it can be compiled once per number of words */
+__attribute__((always_inline))
+static inline uint64_t perft_words(const board_context_t *context,
+  perft_ply_t *line, size_t depth, const size_t words){
+  if(depth > PERFT_MAX_PLY){
+    depth = PERFT_MAX_PLY;
+  }
+  uint64_t nodes = 0;
+  size_t ply = 0;
+  bool expand = true;
+  while(true){
+    perft_ply_t *node = &line[ply];
+    perft_ply_t *child = &line[ply + 1];
+    if(expand){
+      expand = false;
+      if(ply == depth){
+        nodes++;
+        node->moves = BITBOARD_ZERO;
+      } else {
+        node->moves = compute_moves_words(context, node->player,
+          node->opponent, words);
+        if(bitboard_is_zero(node->moves, words)){
+          if(node->passed){
+            /* game over, the position is a leaf */
+            nodes++;
+          } else {
+            child->player = node->opponent;
+            child->opponent = node->player;
+            child->passed = true;
+            ply++;
+            expand = true;
+          }
+          continue;
+        }
+      }
+    }
+    if(bitboard_is_zero(node->moves, words)){
+      if(ply == 0){
+        break;
+      }
+      ply--;
+      continue;
+    }
+    bitboard_t move = bitboard_lowest(node->moves, words);
+    node->moves = bitboard_xor(node->moves, move, words);
+    bitboard_t flips = compute_flips_words(context, move, node->player,
+      node->opponent, words);
+    child->player = bitboard_andnot(node->opponent, flips, words);
+    child->opponent = bitboard_or(node->player, bitboard_or(move, flips,
+      words), words);
+    child->passed = false;
+    ply++;
+    expand = true;
+  }
+  return nodes;
+}
+
+uint64_t board_perft(const board_t *board, const size_t depth){
+  if(board->player == EMPTY_DISC){
+    return 1;
+  }
+  perft_ply_t *line = malloc((PERFT_MAX_PLY + 1) * sizeof(perft_ply_t));
+  if(line == NULL){
+    return 0;
+  }
+  line[0].player = board->white;
+  line[0].opponent = board->black;
+  if(board->player == BLACK_DISC){
+    line[0].player = board->black;
+    line[0].opponent = board->white;
+  }
+  line[0].passed = false;
+  uint64_t nodes;
+  switch (board->context->words){
+    case 1:
+      nodes = perft_words(board->context, line, depth, 1);
+      break;
+    case 2:
+      nodes = perft_words(board->context, line, depth, 2);
+      break;
+    case 3:
+      nodes = perft_words(board->context, line, depth, 3);
+      break;
+    default:
+      nodes = perft_words(board->context, line, depth, BOARD_WORDS);
+  }
+  free(line);
+  return nodes;
+}
+
+/* sets a whole position at once and computes its derived state a single
+ * time: the moves, the passes and the stable discs */
+static void board_load(board_t *board, const size_t size, const disc_t player,
+  const bitboard_t black, const bitboard_t white){
+  board->context = board_context(size);
+  board->size = size;
+  board->player = player;
+  board->black = black;
+  board->white = white;
+  board->stable_black = stable_discs(board->context, black, BITBOARD_ZERO);
+  board->stable_white = stable_discs(board->context, white, BITBOARD_ZERO);
+  board->moves = BITBOARD_ZERO;
+  board->next_move = BITBOARD_ZERO;
+  if(player != EMPTY_DISC){
+    update_moves(board);
+    board_check_end(board);
   }
+}
+
+static bool is_board_size(const size_t size){
+  return (size >= MIN_BOARD_SIZE && size <= MAX_BOARD_SIZE && size % 2 == 0);
+}
+
+board_t *board_alloc(const size_t size, const disc_t player){
   if(size >= MIN_BOARD_SIZE && size <= MAX_BOARD_SIZE && size % 2 == 0){
-    bitboard_t black = 0;
-    bitboard_t white = 0;
-    bitboard_t moves = 0;
-    bitboard_t next_move = 0;
-    bitboard_t stable_black = 0;
-    bitboard_t stable_white = 0;
+    bitboard_t black = BITBOARD_ZERO;
+    bitboard_t white = BITBOARD_ZERO;
+    bitboard_t moves = BITBOARD_ZERO;
+    bitboard_t next_move = BITBOARD_ZERO;
+    bitboard_t stable_black = BITBOARD_ZERO;
+    bitboard_t stable_white = BITBOARD_ZERO;
 
     struct board_t * result = malloc(sizeof(struct board_t));
     if(!result){
       free(result);
       return NULL;
     }
+    result->context = board_context(size);
     result->size = size;
     result->player = player;
     result->black = black;
@@ -700,29 +1836,70 @@ void board_free(board_t *board){
 }
 
 board_t *board_init(const size_t size){
-  disc_t player;
-  if(size == 2){
-    player = EMPTY_DISC;
-  } else {
-    player = BLACK_DISC;
+  if(!is_board_size(size)){
+    return NULL;
+  }
+  const size_t middle = size / 2;
+  bitboard_t black = BITBOARD_ZERO;
+  bitboard_t white = BITBOARD_ZERO;
+  bitboard_set_bit(&white, (size * (middle - 1)) + middle - 1);
+  bitboard_set_bit(&black, (size * (middle - 1)) + middle);
+  bitboard_set_bit(&black, (size * middle) + middle - 1);
+  bitboard_set_bit(&white, (size * middle) + middle);
+  /* the 2x2 board is full from the start */
+  return board_from_bitboards(size, size == 2 ? EMPTY_DISC : BLACK_DISC,
+    black, white);
+}
+
+board_t *board_from_bitboards(const size_t size, const disc_t player,
+  const bitboard_t black, const bitboard_t white){
+  if(!is_board_size(size) || (player != BLACK_DISC && player != WHITE_DISC &&
+    player != EMPTY_DISC)){
+    return NULL;
+  }
+  const bitboard_t full = board_context(size)->full;
+  if(!bitboard_is_zero(bitboard_and(black, white, BOARD_WORDS),
+    BOARD_WORDS) || !bitboard_is_zero(bitboard_andnot(bitboard_or(black,
+    white, BOARD_WORDS), full, BOARD_WORDS), BOARD_WORDS)){
+    return NULL;
+  }
+  board_t *board = board_alloc(size, player);
+  if(board != NULL){
+    board_load(board, size, player, black, white);
   }
-  struct board_t *reversi = board_alloc(size, player, true);
-  if(reversi == NULL){
+  return board;
+}
+
+board_t *board_from_cells(const size_t size, const disc_t player,
+  const disc_t cells[]){
+  if(!is_board_size(size)){
     return NULL;
   }
-  board_set(reversi, WHITE_DISC,(size / 2) - 1,(size / 2) - 1);
-  board_set(reversi, BLACK_DISC,(size / 2) - 1,(size / 2));
-  board_set(reversi, BLACK_DISC,(size / 2),(size / 2) - 1);
-  board_set(reversi, WHITE_DISC,(size / 2),(size / 2));
-  reversi->moves = compute_moves(size, reversi->black, reversi->white);
-  return reversi;
+  bitboard_t black = BITBOARD_ZERO;
+  bitboard_t white = BITBOARD_ZERO;
+  for(size_t i = 0; i < size * size; i++){
+    switch(cells[i]){
+      case BLACK_DISC:
+        bitboard_set_bit(&black, i);
+        break;
+      case WHITE_DISC:
+        bitboard_set_bit(&white, i);
+        break;
+      case EMPTY_DISC:
+      case HINT_DISC:
+        break;
+      default:
+        return NULL;
+    }
+  }
+  return board_from_bitboards(size, player, black, white);
 }
 
 board_t *board_copy(const board_t *board){
   if(board == NULL){
     return NULL;
   }
-  struct board_t * copy = board_alloc(board->size, board->player, false);
+  struct board_t * copy = board_alloc(board->size, board->player);
   copy->black = board->black;
   copy->white = board->white;
   copy->moves = board->moves;
@@ -748,17 +1925,17 @@ disc_t board_get(const board_t *board, const size_t row, const size_t column){
   if(board == NULL){
     return EMPTY_DISC;
   }
-  int shift = ((board->size * row) + column);
-  bitboard_t bitboard = board->black >> shift;
-  if(bitboard & 0x1){
+  if(row >= board->size || column >= board->size){
+    return EMPTY_DISC;
+  }
+  size_t index = ((board->size * row) + column);
+  if(bitboard_test(board->black, index)){
     return BLACK_DISC;
   }
-  bitboard = board->white >> shift;
-  if(bitboard & 0x1){
+  if(bitboard_test(board->white, index)){
     return WHITE_DISC;
   }
-  bitboard = board->moves >> shift;
-  if(bitboard & 0x1){
+  if(bitboard_test(board->moves, index)){
     return HINT_DISC;
   }
   return EMPTY_DISC;
@@ -767,25 +1944,25 @@ disc_t board_get(const board_t *board, const size_t row, const size_t column){
 void board_set(board_t *board, const disc_t disc, const size_t row,
   const size_t column){
   if(board != NULL && row < board->size && column < board->size){
+    const size_t words = board->context->words;
     bitboard_t masc = set_bitboard(board->size, row, column);
-    bitboard_t inverse_masc = ~masc;
     switch (disc){
       case BLACK_DISC:
-        board->black = board->black | masc;
-        board->white = board->white & inverse_masc;
-        board->moves = board->moves & inverse_masc;
+        board->black = bitboard_or(board->black, masc, words);
+        board->white = bitboard_andnot(board->white, masc, words);
+        board->moves = bitboard_andnot(board->moves, masc, words);
         break;
       case WHITE_DISC:
-        board->white = board->white | masc;
-        board->black = board->black & inverse_masc;
-        board->moves = board->moves & inverse_masc;
+        board->white = bitboard_or(board->white, masc, words);
+        board->black = bitboard_andnot(board->black, masc, words);
+        board->moves = bitboard_andnot(board->moves, masc, words);
         break;
       case EMPTY_DISC:
-        board->black = board->black & inverse_masc;
-        board->white = board->white & inverse_masc;
+        board->black = bitboard_andnot(board->black, masc, words);
+        board->white = bitboard_andnot(board->white, masc, words);
         break;
       case HINT_DISC:
-        board->moves = board->moves | masc;
+        board->moves = bitboard_or(board->moves, masc, words);
         break;
     }
     update_moves(board);
@@ -795,12 +1972,340 @@ void board_set(board_t *board, const disc_t disc, const size_t row,
 score_t board_score(const board_t *board){
   unsigned short white = 0;
   unsigned short black = 0;
-  white = bitboard_popcount(board->white);
-  black = bitboard_popcount(board->black);
+  white = bitboard_popcount(board->white, board->context->words);
+  black = bitboard_popcount(board->black, board->context->words);
   score_t score = { .black = black, .white = white };
   return score;
 }
 
+/* finalizer of splitmix64, every input bit changes half of the output */
+static uint64_t hash_mix(uint64_t x){
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+uint64_t board_hash(const board_t *board){
+  uint64_t hash = (board->size << 8) | (uint64_t) board->player;
+  for(size_t i = 0; i < board->context->words; i++){
+    hash = hash_mix(hash ^ board->black.word[i]);
+    hash = hash_mix(hash ^ board->white.word[i]);
+  }
+  return hash;
+}
+
+const board_context_t *board_get_context(const board_t *board){
+  return board->context;
+}
+
+void board_node_init(board_node_t *node, const board_t *board){
+  if(board->player == WHITE_DISC){
+    node->player = board->white;
+    node->opponent = board->black;
+  } else {
+    node->player = board->black;
+    node->opponent = board->white;
+  }
+  node->moves = board->player == EMPTY_DISC ? BITBOARD_ZERO : board->moves;
+}
+
+/* The node functions are compiled once per number of words like the
+ * kernels they call, an 8x8 node is worked on as three single words */
+
+/* board_node_play for boards of the given number of words */
+__attribute__((always_inline))
+static inline bool node_play_words(const board_context_t *context,
+  const board_node_t *node, const size_t square, board_node_t *child,
+  const size_t words){
+  const bitboard_t move = bitboard_bit(square);
+  const bitboard_t flips = compute_flips_words(context, move, node->player,
+    node->opponent, words);
+  const bitboard_t player = bitboard_or(bitboard_or(node->player, move,
+    words), flips, words);
+  const bitboard_t opponent = bitboard_andnot(node->opponent, flips, words);
+  bitboard_t moves = compute_moves_words(context, opponent, player, words);
+  if(!bitboard_is_zero(moves, words)){
+    *child = (board_node_t) { opponent, player, moves };
+    return false;
+  }
+  moves = compute_moves_words(context, player, opponent, words);
+  if(bitboard_is_zero(moves, words)){
+    *child = (board_node_t) { opponent, player, BITBOARD_ZERO };
+    return false;
+  }
+  *child = (board_node_t) { player, opponent, moves };
+  return true;
+}
+
+bool board_node_play(const board_context_t *context, const board_node_t *node,
+  const size_t square, board_node_t *child){
+  switch (context->words){
+    case 1:
+      return node_play_words(context, node, square, child, 1);
+    case 2:
+      return node_play_words(context, node, square, child, 2);
+    case 3:
+      return node_play_words(context, node, square, child, 3);
+    default:
+      return node_play_words(context, node, square, child, BOARD_WORDS);
+  }
+}
+
+/* board_node_moves for boards of the given number of words */
+__attribute__((always_inline))
+static inline size_t node_moves_words(const board_node_t *node,
+  unsigned short squares[], const size_t words){
+  size_t count = 0;
+  for(size_t i = (words < BOARD_WORDS ? words : BOARD_WORDS); i > 0; i--){
+    uint64_t moves = node->moves.word[i - 1];
+    while(moves != 0){
+      const int bit = 63 - __builtin_clzll(moves);
+      squares[count++] = (64 * (i - 1)) + bit;
+      moves ^= (uint64_t) 1 << bit;
+    }
+  }
+  return count;
+}
+
+size_t board_node_moves(const board_context_t *context,
+  const board_node_t *node, unsigned short squares[]){
+  switch (context->words){
+    case 1:
+      return node_moves_words(node, squares, 1);
+    case 2:
+      return node_moves_words(node, squares, 2);
+    case 3:
+      return node_moves_words(node, squares, 3);
+    default:
+      return node_moves_words(node, squares, BOARD_WORDS);
+  }
+}
+
+bool board_node_finished(const board_context_t *context,
+  const board_node_t *node){
+  return bitboard_is_zero(node->moves, context->words);
+}
+
+/* discs of a node of the given number of words */
+__attribute__((always_inline))
+static inline size_t node_discs_words(const board_node_t *node,
+  const size_t words){
+  return bitboard_popcount(bitboard_or(node->player, node->opponent, words),
+    words);
+}
+
+static size_t node_discs(const board_context_t *context,
+  const board_node_t *node){
+  switch (context->words){
+    case 1:
+      return node_discs_words(node, 1);
+    case 2:
+      return node_discs_words(node, 2);
+    case 3:
+      return node_discs_words(node, 3);
+    default:
+      return node_discs_words(node, BOARD_WORDS);
+  }
+}
+
+size_t board_node_empties(const board_context_t *context,
+  const board_node_t *node){
+  return (context->size * context->size) - node_discs(context, node);
+}
+
+game_stage board_node_stage(const board_context_t *context,
+  const board_node_t *node){
+  return stage_of(context->size, node_discs(context, node));
+}
+
+/* board_node_score for boards of the given number of words */
+__attribute__((always_inline))
+static inline int node_score_words(const board_node_t *node,
+  const size_t words){
+  return (int) bitboard_popcount(node->player, words) -
+    (int) bitboard_popcount(node->opponent, words);
+}
+
+int board_node_score(const board_context_t *context,
+  const board_node_t *node){
+  switch (context->words){
+    case 1:
+      return node_score_words(node, 1);
+    case 2:
+      return node_score_words(node, 2);
+    case 3:
+      return node_score_words(node, 3);
+    default:
+      return node_score_words(node, BOARD_WORDS);
+  }
+}
+
+/* board_node_hash for boards of the given number of words */
+__attribute__((always_inline))
+static inline uint64_t node_hash_words(const board_context_t *context,
+  const board_node_t *node, const size_t words){
+  uint64_t hash = context->size << 8;
+#pragma GCC unroll 4
+  for(size_t i = 0; i < words && i < BOARD_WORDS; i++){
+    hash = hash_mix(hash ^ node->player.word[i]);
+    hash = hash_mix(hash ^ node->opponent.word[i]);
+  }
+  return hash;
+}
+
+uint64_t board_node_hash(const board_context_t *context,
+  const board_node_t *node){
+  switch (context->words){
+    case 1:
+      return node_hash_words(context, node, 1);
+    case 2:
+      return node_hash_words(context, node, 2);
+    case 3:
+      return node_hash_words(context, node, 3);
+    default:
+      return node_hash_words(context, node, BOARD_WORDS);
+  }
+}
+
+/* stable discs of player, starting from none, for boards of the given
+ * number of words */
+__attribute__((always_inline))
+static inline bitboard_t node_stable_discs_words(
+  const board_context_t *context, const bitboard_t player,
+  const size_t words){
+  bitboard_t stable = BITBOARD_ZERO;
+#ifdef BOARD_AVX2
+  if(words == 1 && context->avx2){
+    stable.word[0] = stable_discs_avx2(context, player.word[0], 0);
+    return stable;
+  }
+#endif
+  while(true){
+    const bitboard_t grown = bitboard_or(stable, stable_words(context,
+      player, stable, words), words);
+    if(bitboard_equal(grown, stable, words)){
+      return stable;
+    }
+    stable = grown;
+  }
+}
+
+/* node_stable for boards of the given number of words */
+__attribute__((always_inline))
+static inline int node_stable_words(const board_context_t *context,
+  const board_node_t *node, const size_t words){
+  if(bitboard_is_zero(bitboard_and(bitboard_or(node->player, node->opponent,
+    words), context->stable_check, words), words)){
+    return 0;
+  }
+  return (int) bitboard_popcount(node_stable_discs_words(context,
+    node->player, words), words) - (int) bitboard_popcount(
+    node_stable_discs_words(context, node->opponent, words), words);
+}
+
+/* stable discs of the player to move minus those of the opponent, 0 while
+ * no corner is taken */
+static int node_stable(const board_context_t *context,
+  const board_node_t *node){
+  switch (context->words){
+    case 1:
+      return node_stable_words(context, node, 1);
+    case 2:
+      return node_stable_words(context, node, 2);
+    case 3:
+      return node_stable_words(context, node, 3);
+    default:
+      return node_stable_words(context, node, BOARD_WORDS);
+  }
+}
+
+/* board_node_features for boards of the given number of words */
+__attribute__((always_inline))
+static inline void node_features_words(const board_context_t *context,
+  const board_node_t *node, board_features_t *features, const size_t words){
+  const bitboard_t player = node->player;
+  const bitboard_t opponent = node->opponent;
+  features->score = node_score_words(node, words);
+  /* the moves of the player are those of the node */
+  fills_t fills;
+  fills_compute(context, player, opponent, false, &fills);
+  fills_features_words(context, &fills, node->moves, true, features, words);
+  features->stable = node_stable_words(context, node, words);
+  features->disc_evaluation = 0;
+  for(int i = 0; i < 8; i++){
+    const bitboard_t region = context->regions[i];
+    features->regions[i] = bitboard_popcount(bitboard_and(player, region,
+      words), words) - bitboard_popcount(bitboard_and(opponent, region,
+      words), words);
+    features->disc_evaluation += region_values[i] * features->regions[i];
+  }
+}
+
+#ifdef BOARD_AVX2
+/* node_features_words of a 64 bits board built for popcnt: the fills and
+ * the stable discs take the AVX2 path and the 26 counts are instructions */
+__attribute__((target("avx2,popcnt")))
+static void node_features_popcnt(const board_context_t *context,
+  const board_node_t *node, board_features_t *features){
+  node_features_words(context, node, features, 1);
+}
+#endif
+
+void board_node_features(const board_context_t *context,
+  const board_node_t *node, board_features_t *features){
+  switch (context->words){
+    case 1:
+#ifdef BOARD_AVX2
+      if(context->popcnt){
+        node_features_popcnt(context, node, features);
+        return;
+      }
+#endif
+      node_features_words(context, node, features, 1);
+      return;
+    case 2:
+      node_features_words(context, node, features, 2);
+      return;
+    case 3:
+      node_features_words(context, node, features, 3);
+      return;
+    default:
+      node_features_words(context, node, features, BOARD_WORDS);
+  }
+}
+
+void board_node_features_batch(const board_context_t *context,
+  const board_node_t nodes[], const size_t count,
+  board_features_t features[]){
+  size_t first = 0;
+#ifdef BOARD_AVX2
+  /* a group costs about as much as FEATURE_GROUP - 1 scalar evaluations,
+   * the last nodes of a smaller group are evaluated one by one */
+  if(context->avx2){
+    for(; first + FEATURE_GROUP - 1 <= count; first += FEATURE_GROUP){
+      uint64_t player[FEATURE_GROUP] = { 0 };
+      uint64_t opponent[FEATURE_GROUP] = { 0 };
+      size_t group = count - first;
+      if(group > FEATURE_GROUP){
+        group = FEATURE_GROUP;
+      }
+      for(size_t i = 0; i < group; i++){
+        player[i] = nodes[first + i].player.word[0];
+        opponent[i] = nodes[first + i].opponent.word[0];
+      }
+      avx2_features_group(context, player, opponent, group,
+        &features[first]);
+      for(size_t i = 0; i < group; i++){
+        features[first + i].stable = node_stable(context, &nodes[first + i]);
+      }
+    }
+  }
+#endif
+  for(size_t i = first; i < count; i++){
+    board_node_features(context, &nodes[i], &features[i]);
+  }
+}
+
 int board_print(const board_t *board, FILE *fd){
   if(fd == NULL){
     printf("No file descriptor found\n");
@@ -836,3 +2341,380 @@ int board_print(const board_t *board, FILE *fd){
   }
   return result;
 }
+
+parse_error_t board_parse(const char *text, const size_t length,
+  board_t **board, parse_info_t *info){
+  parse_info_t local;
+  if(info == NULL){
+    info = &local;
+  }
+  info->line = 0;
+  info->character = '\0';
+  info->rows = 0;
+  info->size = 0;
+  *board = NULL;
+
+  disc_t player = EMPTY_DISC;
+  bitboard_t black = BITBOARD_ZERO;
+  bitboard_t white = BITBOARD_ZERO;
+  size_t i = 0;
+  while(i < length){
+    info->line++;
+    size_t row_size = 0;
+    uint32_t black_row = 0;
+    uint32_t white_row = 0;
+    bool comment = false;
+    for(; i < length && text[i] != '\n'; i++){
+      const char c = text[i];
+      if(comment || c == ' ' || c == '\t' || c == '\r'){
+        continue;
+      }
+      if(c == '#'){
+        comment = true;
+      } else if(c != BLACK_DISC && c != WHITE_DISC && c != EMPTY_DISC){
+        info->character = c;
+        return PARSE_ERROR_CHARACTER;
+      } else if(player == EMPTY_DISC){
+        if(c == EMPTY_DISC){
+          return PARSE_ERROR_PLAYER;
+        }
+        player = c;
+      } else {
+        if(row_size < MAX_BOARD_SIZE){
+          uint32_t cell = (uint32_t) 1 << row_size;
+          if(c == BLACK_DISC){
+            black_row |= cell;
+          } else if(c == WHITE_DISC){
+            white_row |= cell;
+          }
+        }
+        row_size++;
+      }
+    }
+    /* skips the '\n' */
+    i++;
+    if(row_size == 0){
+      continue;
+    }
+    if(!is_board_size(row_size) ||
+      (info->size != 0 && info->size != row_size)){
+      return PARSE_ERROR_ROW;
+    }
+    info->size = row_size;
+    if(info->rows < info->size){
+      for(size_t column = 0; column < info->size; column++){
+        if((black_row >> column) & 0x1){
+          bitboard_set_bit(&black, (info->rows * info->size) + column);
+        }
+        if((white_row >> column) & 0x1){
+          bitboard_set_bit(&white, (info->rows * info->size) + column);
+        }
+      }
+    }
+    info->rows++;
+  }
+  if(player == EMPTY_DISC){
+    return PARSE_ERROR_PLAYER;
+  }
+  if(info->rows != info->size){
+    return PARSE_ERROR_ROWS;
+  }
+  *board = board_alloc(info->size, player);
+  if(*board == NULL){
+    return PARSE_ERROR_MEMORY;
+  }
+  board_load(*board, info->size, player, black, white);
+  return PARSE_OK;
+}
+
+/* returns the size of a board with the given number of cells, 0 if none */
+static size_t size_of_cells(const size_t cells){
+  for(size_t size = MIN_BOARD_SIZE; size <= MAX_BOARD_SIZE; size += 2){
+    if(size * size == cells){
+      return size;
+    }
+  }
+  return 0;
+}
+
+parse_error_t board_parse_line(board_t *board, const char *text,
+  const size_t length, int *label){
+  bitboard_t black = BITBOARD_ZERO;
+  bitboard_t white = BITBOARD_ZERO;
+  size_t cells = 0;
+  size_t i = 0;
+  while(i < length && (text[i] == ' ' || text[i] == '\t')){
+    i++;
+  }
+  for(; i < length && cells < MAX_BOARD_SIZE * MAX_BOARD_SIZE; i++){
+    const char c = text[i];
+    if(c == BLACK_DISC){
+      bitboard_set_bit(&black, cells);
+    } else if(c == WHITE_DISC){
+      bitboard_set_bit(&white, cells);
+    } else if(c != EMPTY_DISC){
+      break;
+    }
+    cells++;
+  }
+  const size_t size = size_of_cells(cells);
+  if(size == 0){
+    return PARSE_ERROR_ROW;
+  }
+  while(i < length && (text[i] == ' ' || text[i] == '\t')){
+    i++;
+  }
+  if(i == length || (text[i] != BLACK_DISC && text[i] != WHITE_DISC &&
+    text[i] != EMPTY_DISC)){
+    return PARSE_ERROR_PLAYER;
+  }
+  const disc_t player = text[i];
+  i++;
+  while(i < length && (text[i] == ' ' || text[i] == '\t')){
+    i++;
+  }
+  int result = POSITION_NO_LABEL;
+  if(i < length && (text[i] == '-' || text[i] == '+' ||
+    (text[i] >= '0' && text[i] <= '9'))){
+    bool negative = (text[i] == '-');
+    if(text[i] == '-' || text[i] == '+'){
+      i++;
+    }
+    result = 0;
+    size_t digits = 0;
+    for(; i < length && text[i] >= '0' && text[i] <= '9' && digits < 4;
+      i++, digits++){
+      result = (10 * result) + (text[i] - '0');
+    }
+    if(digits == 0 || result > MAX_BOARD_SIZE * MAX_BOARD_SIZE){
+      return PARSE_ERROR_CHARACTER;
+    }
+    if(negative){
+      result = -result;
+    }
+  }
+  for(; i < length; i++){
+    if(text[i] != ' ' && text[i] != '\t' && text[i] != '\r'){
+      return PARSE_ERROR_CHARACTER;
+    }
+  }
+  board_load(board, size, player, black, white);
+  if(label != NULL){
+    *label = result;
+  }
+  return PARSE_OK;
+}
+
+int board_print_line(const board_t *board, const int label, FILE *fd){
+  char line[(MAX_BOARD_SIZE * MAX_BOARD_SIZE) + 4];
+  const size_t cells = board->size * board->size;
+  for(size_t i = 0; i < cells; i++){
+    if(bitboard_test(board->black, i)){
+      line[i] = BLACK_DISC;
+    } else if(bitboard_test(board->white, i)){
+      line[i] = WHITE_DISC;
+    } else {
+      line[i] = EMPTY_DISC;
+    }
+  }
+  line[cells] = ' ';
+  line[cells + 1] = board->player;
+  line[cells + 2] = '\0';
+  if(label == POSITION_NO_LABEL){
+    return fprintf(fd, "%s\n", line);
+  }
+  return fprintf(fd, "%s %d\n", line, label);
+}
+
+/* bytes used by one bitboard in a binary record, 8 per word */
+static size_t record_bitboard_length(const size_t size){
+  return 8 * (((size * size) + 63) / 64);
+}
+
+/* flag of the first byte of a record followed by a label byte */
+#define RECORD_LABEL 0x40
+
+size_t board_record_length(const board_t *board, const int label){
+  return 1 + (2 * record_bitboard_length(board->size)) +
+    (label == POSITION_NO_LABEL ? 0 : 1);
+}
+
+static void record_write_bitboard(unsigned char *buffer,
+  const bitboard_t bitboard, const size_t length){
+  for(size_t i = 0; i < length; i++){
+    buffer[i] = (unsigned char) (bitboard.word[i / 8] >> (8 * (i % 8)));
+  }
+}
+
+static bitboard_t record_read_bitboard(const unsigned char *buffer,
+  const size_t length){
+  bitboard_t bitboard = BITBOARD_ZERO;
+  for(size_t i = 0; i < length; i++){
+    bitboard.word[i / 8] |= (uint64_t) buffer[i] << (8 * (i % 8));
+  }
+  return bitboard;
+}
+
+/* a label of a binary record, clamped into a signed byte (the final
+ * scores of boards above 10x10 may not fit) */
+static unsigned char record_label(const int label){
+  if(label > 126){
+    return 126;
+  }
+  if(label < -128){
+    return (unsigned char) (signed char) -128;
+  }
+  return (unsigned char) (signed char) label;
+}
+
+/* player codes of the first byte of a record */
+static const disc_t record_players[3] = { EMPTY_DISC, BLACK_DISC, WHITE_DISC };
+
+size_t board_write_record(const board_t *board, const int label,
+  unsigned char *buffer){
+  unsigned char player = 0;
+  if(board->player == BLACK_DISC){
+    player = 1;
+  } else if(board->player == WHITE_DISC){
+    player = 2;
+  }
+  const size_t length = record_bitboard_length(board->size);
+  /* the size field has 4 bits, 16 is written as 0 */
+  buffer[0] = (unsigned char) (((board->size % 16) << 2) | player);
+  record_write_bitboard(&buffer[1], board->black, length);
+  record_write_bitboard(&buffer[1 + length], board->white, length);
+  if(label == POSITION_NO_LABEL){
+    return 1 + (2 * length);
+  }
+  buffer[0] |= RECORD_LABEL;
+  buffer[1 + (2 * length)] = record_label(label);
+  return 2 + (2 * length);
+}
+
+parse_error_t board_read_record(board_t *board, const unsigned char *buffer,
+  const size_t available, size_t *used, int *label){
+  if(available == 0){
+    return PARSE_END;
+  }
+  const bool labeled = (buffer[0] & RECORD_LABEL) != 0;
+  size_t size = (buffer[0] & ~RECORD_LABEL) >> 2;
+  if(size == 0){
+    size = 16;
+  }
+  const size_t player = buffer[0] & 0x3;
+  if(!is_board_size(size) || player > 2){
+    return PARSE_ERROR_RECORD;
+  }
+  const size_t length = record_bitboard_length(size);
+  const size_t record_length = 1 + (2 * length) + (labeled ? 1 : 0);
+  if(available < record_length){
+    return PARSE_ERROR_RECORD;
+  }
+  bitboard_t black = record_read_bitboard(&buffer[1], length);
+  bitboard_t white = record_read_bitboard(&buffer[1 + length], length);
+  const board_context_t *context = board_context(size);
+  if(!bitboard_is_zero(bitboard_and(black, white, BOARD_WORDS), BOARD_WORDS)
+    || !bitboard_is_zero(bitboard_andnot(bitboard_or(black, white,
+    BOARD_WORDS), context->full, BOARD_WORDS), BOARD_WORDS)){
+    return PARSE_ERROR_RECORD;
+  }
+  board_load(board, size, record_players[player], black, white);
+  if(label != NULL){
+    *label = labeled ? (signed char) buffer[1 + (2 * length)] :
+      POSITION_NO_LABEL;
+  }
+  *used = record_length;
+  return PARSE_OK;
+}
+
+/* A memory mapped file of positions */
+struct positions_t
+{
+  const unsigned char *data;
+  size_t length;
+  size_t offset;
+  size_t line;
+  bool binary;
+};
+
+positions_t *positions_open(const char *filename){
+  int fd = open(filename, O_RDONLY);
+  if(fd == -1){
+    return NULL;
+  }
+  struct stat status;
+  if(fstat(fd, &status) == -1){
+    close(fd);
+    return NULL;
+  }
+  positions_t *positions = malloc(sizeof(positions_t));
+  if(positions == NULL){
+    close(fd);
+    return NULL;
+  }
+  positions->data = NULL;
+  positions->length = status.st_size;
+  if(positions->length > 0){
+    void *data = mmap(NULL, positions->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED){
+      close(fd);
+      free(positions);
+      return NULL;
+    }
+    posix_madvise(data, positions->length, POSIX_MADV_SEQUENTIAL);
+    positions->data = data;
+  }
+  close(fd);
+  const size_t magic = strlen(POSITIONS_MAGIC);
+  positions->binary = (positions->length >= magic &&
+    memcmp(positions->data, POSITIONS_MAGIC, magic) == 0);
+  positions->offset = positions->binary ? magic : 0;
+  positions->line = 0;
+  return positions;
+}
+
+parse_error_t positions_next(positions_t *positions, board_t *board,
+  int *label){
+  if(positions->binary){
+    size_t used = 0;
+    parse_error_t error = board_read_record(board,
+      &positions->data[positions->offset],
+      positions->length - positions->offset, &used, label);
+    positions->offset += used;
+    positions->line++;
+    return error;
+  }
+  while(positions->offset < positions->length){
+    const char *start = (const char *) &positions->data[positions->offset];
+    const size_t left = positions->length - positions->offset;
+    const char *end = memchr(start, '\n', left);
+    size_t length = (end == NULL) ? left : (size_t) (end - start);
+    positions->offset += (end == NULL) ? left : length + 1;
+    positions->line++;
+    size_t i = 0;
+    while(i < length && (start[i] == ' ' || start[i] == '\t' ||
+      start[i] == '\r')){
+      i++;
+    }
+    /* skips blank and comment lines */
+    if(i == length || start[i] == '#'){
+      continue;
+    }
+    return board_parse_line(board, start, length, label);
+  }
+  return PARSE_END;
+}
+
+size_t positions_line(const positions_t *positions){
+  return positions->line;
+}
+
+void positions_close(positions_t *positions){
+  if(positions == NULL){
+    return;
+  }
+  if(positions->data != NULL){
+    munmap((void *) positions->data, positions->length);
+  }
+  free(positions);
+}
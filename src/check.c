@@ -0,0 +1,431 @@
+/* Checks run by make check: the perft counts of every board size against
+ * known values, the positions of random games of every size written to
+ * text and binary position files and to a game file, then read back and
+ * compared with the positions played, the exact endgame scores of the
+ * search in one thread and with split points against a plain negamax, and
+ * the results of seeded node-limited searches, which must not change from
+ * one run or thread count to the next.
+ * Every failure is printed and the exit status is EXIT_FAILURE if any */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <board.h>
+#include <games.h>
+#include <rng.h>
+#include <search.h>
+
+/* random games played on every size, the odd ones from a custom start */
+#define CHECK_GAMES 16
+#define CHECK_SEED 0xc4ec
+/* random plies played before the custom start of a game */
+#define CHECK_START_PLIES 5
+/* longest name of a file of the checks */
+#define CHECK_NAME 64
+/* endgame positions searched per size, with at most CHECK_EMPTIES empty
+ * squares, and the threads of the parallel searches */
+#define CHECK_ENDGAMES 4
+#define CHECK_EMPTIES 12
+#define CHECK_THREADS 8
+/* node-limited searches per size, from random positions CHECK_LIMITED_PLIES
+ * into a game, the search stops at CHECK_MAX_NODES before reaching
+ * CHECK_LIMITED_DEPTH */
+#define CHECK_LIMITED 8
+#define CHECK_LIMITED_PLIES 6
+#define CHECK_LIMITED_DEPTH 20
+#define CHECK_MAX_NODES 3000
+
+/* known number of leaves of the move tree of the start of a size */
+typedef struct
+{
+  size_t size;
+  size_t depth;
+  uint64_t leaves;
+} perft_count_t;
+
+/* 8x8 are the published counts, the other sizes the counts of the single
+ * word bitboards (up to 8x8) and of the first multi-word version */
+static const perft_count_t perft_counts[] = {
+  { 4, 9, 20044 },
+  { 4, 12, 57436 },
+  { 6, 9, 2114912 },
+  { 8, 9, 3005288 },
+  { 8, 10, 24571284 },
+  { 10, 9, 3045812 },
+  { 12, 9, 3046196 },
+  { 14, 9, 3046196 },
+  { 16, 9, 3046196 }
+};
+
+static bool check_perft(void){
+  bool ok = true;
+  for(size_t i = 0; i < sizeof(perft_counts) / sizeof(perft_count_t); i++){
+    const perft_count_t *count = &perft_counts[i];
+    board_t *board = board_init(count->size);
+    if(board == NULL){
+      fprintf(stderr, "check: error: out of memory\n");
+      return false;
+    }
+    const uint64_t leaves = board_perft(board, count->depth);
+    board_free(board);
+    if(leaves != count->leaves){
+      fprintf(stderr, "check: %ldx%ld perft(%ld) = %" PRIu64 ", expected %"
+        PRIu64 "\n", count->size, count->size, count->depth, leaves,
+        count->leaves);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+/* label of the position at ply of a game, small enough for a record */
+static int ply_label(size_t ply){
+  return (int) (ply % 64) - 32;
+}
+
+/* the positions of the files of a size, and the positions played */
+typedef struct
+{
+  char text_name[CHECK_NAME];
+  char binary_name[CHECK_NAME];
+  char games_name[CHECK_NAME];
+  FILE *text;
+  FILE *binary;
+  games_writer_t *games;
+  /* the positions played, as the lines of a text position file */
+  char *expected;
+  size_t expected_length;
+  FILE *played;
+} corpus_t;
+
+/* plays a random game of size from a custom start if custom, and writes
+ * its positions to the files of corpus */
+static bool corpus_play(corpus_t *corpus, size_t size, bool custom){
+  board_t *board = board_init(size);
+  if(board == NULL){
+    return false;
+  }
+  for(size_t ply = 0; custom && ply < CHECK_START_PLIES; ply++){
+    board_play(board, board_random_move(board));
+  }
+  game_record_t game;
+  game_record_init(&game, board);
+  unsigned char record[POSITION_MAX_RECORD];
+  size_t ply = 0;
+  bool ok = true;
+  while(ok){
+    const int label = ply_label(ply);
+    board_print_line(board, label, corpus->played);
+    board_print_line(board, label, corpus->text);
+    fwrite(record, 1, board_write_record(board, label, record),
+      corpus->binary);
+    if(board_player(board) == EMPTY_DISC){
+      break;
+    }
+    move_t move = board_random_move(board);
+    game_record_add(&game, move);
+    ok = board_play(board, move);
+    ply++;
+  }
+  game_record_finish(&game, board);
+  board_free(board);
+  return ok && games_writer_append(corpus->games, &game);
+}
+
+/* reads back the positions file name and compares them with the
+ * positions played */
+static bool check_positions(const corpus_t *corpus, const char *name,
+  size_t size){
+  positions_t *positions = positions_open(name);
+  board_t *board = board_init(size);
+  char *read = NULL;
+  size_t length = 0;
+  FILE *stream = open_memstream(&read, &length);
+  bool ok = positions != NULL && board != NULL && stream != NULL;
+  parse_error_t error = PARSE_OK;
+  int label;
+  while(ok &&
+    (error = positions_next(positions, board, &label)) == PARSE_OK){
+    board_print_line(board, label, stream);
+  }
+  if(stream != NULL){
+    fclose(stream);
+  }
+  if(ok && error != PARSE_END){
+    fprintf(stderr, "check: %ldx%ld %s: error %d at position %ld\n", size,
+      size, name, error, positions_line(positions));
+    ok = false;
+  } else if(ok && (length != corpus->expected_length ||
+    memcmp(read, corpus->expected, length) != 0)){
+    fprintf(stderr, "check: %ldx%ld %s: the positions read differ from "
+      "the positions written\n", size, size, name);
+    ok = false;
+  }
+  free(read);
+  board_free(board);
+  positions_close(positions);
+  return ok;
+}
+
+/* reads back the game file, replays the games and compares their
+ * positions with the positions played */
+static bool check_games(const corpus_t *corpus, size_t size){
+  games_reader_t *reader = games_reader_open(corpus->games_name);
+  char *read = NULL;
+  size_t length = 0;
+  FILE *stream = open_memstream(&read, &length);
+  bool ok = reader != NULL && stream != NULL;
+  game_record_t game;
+  parse_error_t error = PARSE_OK;
+  size_t games = 0;
+  while(ok && (error = games_reader_next(reader, &game)) == PARSE_OK){
+    board_t *board = game_record_start(&game);
+    ok = board != NULL && game.size == size &&
+      (game.start_length != 0) == (games % 2 == 1);
+    for(size_t ply = 0; ok && ply <= game.count; ply++){
+      board_print_line(board, ply_label(ply), stream);
+      if(ply < game.count){
+        ok = board_play(board, game.moves[ply]);
+      }
+    }
+    if(ok){
+      /* results are stored in a signed byte */
+      score_t score = board_score(board);
+      int result = score.black - score.white;
+      result = result > 127 ? 127 : (result < -128 ? -128 : result);
+      ok = board_player(board) == EMPTY_DISC && game.result == result;
+    }
+    if(!ok){
+      fprintf(stderr, "check: %ldx%ld %s: game %ld differs from the game "
+        "written\n", size, size, corpus->games_name, games + 1);
+    }
+    board_free(board);
+    games++;
+  }
+  if(stream != NULL){
+    fclose(stream);
+  }
+  if(ok && (error != PARSE_END || games != CHECK_GAMES)){
+    fprintf(stderr, "check: %ldx%ld %s: %ld of %d games read\n", size, size,
+      corpus->games_name, games, CHECK_GAMES);
+    ok = false;
+  } else if(ok && (length != corpus->expected_length ||
+    memcmp(read, corpus->expected, length) != 0)){
+    fprintf(stderr, "check: %ldx%ld %s: the games replayed differ from "
+      "the games written\n", size, size, corpus->games_name);
+    ok = false;
+  }
+  free(read);
+  games_reader_close(reader);
+  return ok;
+}
+
+/* writes random games of size to files of directory, reads them back and
+ * removes the files */
+static bool check_records(const char *directory, size_t size){
+  corpus_t corpus = { .expected = NULL, .expected_length = 0 };
+  snprintf(corpus.text_name, CHECK_NAME, "%s/positions.txt", directory);
+  snprintf(corpus.binary_name, CHECK_NAME, "%s/positions.bin", directory);
+  snprintf(corpus.games_name, CHECK_NAME, "%s/games.bin", directory);
+  corpus.text = fopen(corpus.text_name, "w");
+  corpus.binary = fopen(corpus.binary_name, "wb");
+  corpus.games = games_writer_open(corpus.games_name);
+  corpus.played = open_memstream(&corpus.expected, &corpus.expected_length);
+  bool ok = corpus.text != NULL && corpus.binary != NULL &&
+    corpus.games != NULL && corpus.played != NULL;
+  if(ok){
+    fputs(POSITIONS_MAGIC, corpus.binary);
+  }
+  for(size_t game = 0; ok && game < CHECK_GAMES; game++){
+    ok = corpus_play(&corpus, size, game % 2 == 1);
+  }
+  /* every file is closed, whether or not it was written */
+  if(corpus.text != NULL && fclose(corpus.text) != 0){
+    ok = false;
+  }
+  if(corpus.binary != NULL && fclose(corpus.binary) != 0){
+    ok = false;
+  }
+  if(corpus.games != NULL && !games_writer_close(corpus.games)){
+    ok = false;
+  }
+  if(corpus.played != NULL){
+    fclose(corpus.played);
+  }
+  if(!ok){
+    fprintf(stderr, "check: %ldx%ld: error: could not write the files of "
+      "%s\n", size, size, directory);
+  } else {
+    ok = check_positions(&corpus, corpus.text_name, size);
+    ok = check_positions(&corpus, corpus.binary_name, size) && ok;
+    ok = check_games(&corpus, size) && ok;
+  }
+  unlink(corpus.text_name);
+  unlink(corpus.binary_name);
+  unlink(corpus.games_name);
+  free(corpus.expected);
+  return ok;
+}
+
+/* exact value of node for the player to move, scored as the search scores
+ * finished games, by a negamax whose only pruning is alpha-beta */
+static int negamax(const board_context_t *context, const board_node_t *node,
+  int alpha, int beta){
+  if(board_node_finished(context, node)){
+    const int difference = board_node_score(context, node);
+    if(difference > 0){
+      return SEARCH_WIN + difference;
+    } else if(difference < 0){
+      return -SEARCH_WIN + difference;
+    }
+    return 0;
+  }
+  unsigned short squares[SEARCH_MAX_MOVES];
+  const size_t count = board_node_moves(context, node, squares);
+  int best = -MAX_INT;
+  for(size_t i = 0; i < count && best < beta; i++){
+    board_node_t child;
+    /* the player moves again when the opponent passes */
+    const int value = board_node_play(context, node, squares[i], &child) ?
+      negamax(context, &child, alpha, beta) :
+      -negamax(context, &child, -beta, -alpha);
+    if(value > best){
+      best = value;
+      if(best > alpha){
+        alpha = best;
+      }
+    }
+  }
+  return best;
+}
+
+/* plays random games of size until CHECK_EMPTIES squares are left, then
+ * compares the scores of the search with 1 and CHECK_THREADS threads,
+ * whose deep nodes are split between the threads, with negamax */
+static bool check_endgames(size_t size){
+  bool ok = true;
+  size_t game = 0;
+  while(game < CHECK_ENDGAMES){
+    board_t *board = board_init(size);
+    if(board == NULL){
+      fprintf(stderr, "check: error: out of memory\n");
+      return false;
+    }
+    while(board_player(board) != EMPTY_DISC &&
+      turns_left(board) > CHECK_EMPTIES){
+      board_play(board, board_random_move(board));
+    }
+    /* games over before the endgame are played again */
+    if(board_player(board) == EMPTY_DISC){
+      board_free(board);
+      continue;
+    }
+    game++;
+    board_node_t node;
+    board_node_init(&node, board);
+    const int expected = negamax(board_get_context(board), &node, -MAX_INT,
+      MAX_INT);
+    const size_t threads[2] = { 1, CHECK_THREADS };
+    for(int i = 0; i < 2; i++){
+      const search_options_t options = { .depth = turns_left(board),
+        .clock = NULL, .max_nodes = 0, .selectivity = 0,
+        .reductions = true, .analysis = false, .threads = threads[i],
+        .stop = NULL };
+      const search_result_t result = search_position(board, &options);
+      if(!result.exact || result.score != expected){
+        fprintf(stderr, "check: %ldx%ld endgame %ld with %ld threads: "
+          "score %d, expected %d\n", size, size, game, threads[i],
+          result.score, expected);
+        ok = false;
+      }
+    }
+    board_free(board);
+  }
+  return ok;
+}
+
+/* searches CHECK_LIMITED positions of size drawn from seed with the node
+ * limit and threads into results */
+static bool limited_run(size_t size, uint64_t seed, size_t threads,
+  search_result_t results[]){
+  rng_seed(seed);
+  for(size_t i = 0; i < CHECK_LIMITED; i++){
+    board_t *board = board_init(size);
+    if(board == NULL){
+      fprintf(stderr, "check: error: out of memory\n");
+      return false;
+    }
+    for(size_t ply = 0; ply < CHECK_LIMITED_PLIES; ply++){
+      board_play(board, board_random_move(board));
+    }
+    const search_options_t options = { .depth = CHECK_LIMITED_DEPTH,
+      .clock = NULL, .max_nodes = CHECK_MAX_NODES, .selectivity = 0,
+      .reductions = true, .analysis = false, .threads = threads,
+      .stop = NULL };
+    results[i] = search_position(board, &options);
+    board_free(board);
+  }
+  return true;
+}
+
+/* runs the seeded node-limited searches of size twice in one thread and
+ * once with CHECK_THREADS, the moves, scores, depths and nodes must agree */
+static bool check_node_limit(size_t size){
+  const uint64_t seed = CHECK_SEED + size;
+  const size_t threads[3] = { 1, 1, CHECK_THREADS };
+  search_result_t expected[CHECK_LIMITED];
+  search_result_t results[CHECK_LIMITED];
+  if(!limited_run(size, seed, threads[0], expected)){
+    return false;
+  }
+  bool ok = true;
+  for(int run = 1; run < 3; run++){
+    if(!limited_run(size, seed, threads[run], results)){
+      return false;
+    }
+    for(size_t i = 0; i < CHECK_LIMITED; i++){
+      const search_result_t *a = &expected[i];
+      const search_result_t *b = &results[i];
+      if(a->move.row != b->move.row || a->move.column != b->move.column ||
+        a->score != b->score || a->depth != b->depth ||
+        a->nodes != b->nodes){
+        fprintf(stderr, "check: %ldx%ld node-limited search %ld with %ld "
+          "threads differs from the first run\n", size, size, i + 1,
+          threads[run]);
+        ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+int main(void){
+  bool ok = check_perft();
+  char directory[] = "/tmp/reversi-check-XXXXXX";
+  if(mkdtemp(directory) == NULL){
+    fprintf(stderr, "check: error: could not create %s\n", directory);
+    return EXIT_FAILURE;
+  }
+  rng_seed(CHECK_SEED);
+  for(size_t size = 4; size <= MAX_BOARD_SIZE; size += 2){
+    ok = check_records(directory, size) && ok;
+  }
+  rmdir(directory);
+  const size_t endgame_sizes[] = { 4, 6, 8, 12 };
+  for(size_t i = 0; i < sizeof(endgame_sizes) / sizeof(size_t); i++){
+    ok = check_endgames(endgame_sizes[i]) && ok;
+  }
+  /* 4x4 has too few empty squares for the node limit to be reached */
+  for(size_t size = 6; size <= MAX_BOARD_SIZE; size += 2){
+    ok = check_node_limit(size) && ok;
+  }
+  printf("check: %s\n", ok ? "ok" : "FAILED");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,268 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "games.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <board.h>
+
+/* size of the buffer of a writer, flushed when full */
+#define GAMES_BUFFER 65536
+/* longest encoded game */
+#define GAME_MAX_BYTES (4 + GAME_MAX_START + GAME_MAX_MOVES)
+
+struct games_writer_t
+{
+  int fd;
+  pthread_mutex_t lock;
+  size_t length;
+  bool failed;
+  unsigned char buffer[GAMES_BUFFER];
+};
+
+struct games_reader_t
+{
+  const unsigned char *data;
+  size_t length;
+  size_t offset;
+};
+
+void game_record_init(game_record_t *game, const board_t *start){
+  game->size = board_size(start);
+  game->result = 0;
+  game->count = 0;
+  game->start_length = 0;
+  board_t *standard = board_init(game->size);
+  unsigned char record[GAME_MAX_START];
+  size_t length = board_write_record(start, POSITION_NO_LABEL, game->start);
+  size_t standard_length = board_write_record(standard, POSITION_NO_LABEL,
+    record);
+  if(length != standard_length || memcmp(record, game->start, length) != 0){
+    game->start_length = length;
+  }
+  board_free(standard);
+}
+
+void game_record_add(game_record_t *game, const move_t move){
+  if(game->count < GAME_MAX_MOVES){
+    game->moves[game->count] = move;
+    game->count++;
+  }
+}
+
+void game_record_finish(game_record_t *game, const board_t *board){
+  score_t score = board_score(board);
+  game->result = score.black - score.white;
+}
+
+board_t *game_record_start(const game_record_t *game){
+  if(game->start_length == 0){
+    return board_init(game->size);
+  }
+  board_t *board = board_alloc(game->size, EMPTY_DISC);
+  size_t used;
+  if(board != NULL && board_read_record(board, game->start,
+    game->start_length, &used, NULL) != PARSE_OK){
+    board_free(board);
+    return NULL;
+  }
+  return board;
+}
+
+static size_t game_encode(const game_record_t *game, unsigned char *bytes){
+  bytes[0] = (unsigned char) game->size;
+  bytes[1] = game->start_length > 0 ? GAME_CUSTOM_START : 0;
+  int result = game->result;
+  if(result > 127){
+    result = 127;
+  } else if(result < -128){
+    result = -128;
+  }
+  bytes[2] = (unsigned char) (signed char) result;
+  bytes[3] = (unsigned char) game->count;
+  size_t length = 4;
+  memcpy(&bytes[length], game->start, game->start_length);
+  length += game->start_length;
+  for(size_t i = 0; i < game->count; i++){
+    bytes[length] = (unsigned char)
+      ((game->moves[i].row * game->size) + game->moves[i].column);
+    length++;
+  }
+  return length;
+}
+
+/* writes all of the buffer, the lock must be held */
+static bool writer_flush(games_writer_t *writer){
+  size_t written = 0;
+  while(written < writer->length){
+    ssize_t result = write(writer->fd, &writer->buffer[written],
+      writer->length - written);
+    if(result == -1){
+      if(errno == EINTR){
+        continue;
+      }
+      writer->failed = true;
+      break;
+    }
+    written += result;
+  }
+  writer->length = 0;
+  return !writer->failed;
+}
+
+games_writer_t *games_writer_open(const char *filename){
+  games_writer_t *writer = malloc(sizeof(games_writer_t));
+  if(writer == NULL){
+    return NULL;
+  }
+  writer->length = 0;
+  writer->failed = false;
+  /* the first process creating the file writes the magic */
+  writer->fd = open(filename, O_WRONLY | O_APPEND | O_CREAT | O_EXCL, 0644);
+  if(writer->fd != -1){
+    memcpy(writer->buffer, GAMES_MAGIC, strlen(GAMES_MAGIC));
+    writer->length = strlen(GAMES_MAGIC);
+    writer_flush(writer);
+  } else if(errno == EEXIST){
+    writer->fd = open(filename, O_WRONLY | O_APPEND);
+  }
+  if(writer->fd == -1 || writer->failed){
+    if(writer->fd != -1){
+      close(writer->fd);
+    }
+    free(writer);
+    return NULL;
+  }
+  pthread_mutex_init(&writer->lock, NULL);
+  return writer;
+}
+
+bool games_writer_append(games_writer_t *writer, const game_record_t *game){
+  unsigned char bytes[GAME_MAX_BYTES];
+  size_t length = game_encode(game, bytes);
+  pthread_mutex_lock(&writer->lock);
+  if(writer->length + length > GAMES_BUFFER){
+    writer_flush(writer);
+  }
+  memcpy(&writer->buffer[writer->length], bytes, length);
+  writer->length += length;
+  bool ok = !writer->failed;
+  pthread_mutex_unlock(&writer->lock);
+  return ok;
+}
+
+bool games_writer_close(games_writer_t *writer){
+  if(writer == NULL){
+    return false;
+  }
+  writer_flush(writer);
+  bool ok = !writer->failed;
+  if(close(writer->fd) == -1){
+    ok = false;
+  }
+  pthread_mutex_destroy(&writer->lock);
+  free(writer);
+  return ok;
+}
+
+games_reader_t *games_reader_open(const char *filename){
+  int fd = open(filename, O_RDONLY);
+  if(fd == -1){
+    return NULL;
+  }
+  struct stat status;
+  const size_t magic = strlen(GAMES_MAGIC);
+  if(fstat(fd, &status) == -1 || (size_t) status.st_size < magic){
+    close(fd);
+    return NULL;
+  }
+  void *data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED){
+    return NULL;
+  }
+  if(memcmp(data, GAMES_MAGIC, magic) != 0){
+    munmap(data, status.st_size);
+    return NULL;
+  }
+  posix_madvise(data, status.st_size, POSIX_MADV_SEQUENTIAL);
+  games_reader_t *reader = malloc(sizeof(games_reader_t));
+  if(reader == NULL){
+    munmap(data, status.st_size);
+    return NULL;
+  }
+  reader->data = data;
+  reader->length = status.st_size;
+  reader->offset = magic;
+  return reader;
+}
+
+parse_error_t games_reader_next(games_reader_t *reader, game_record_t *game){
+  const unsigned char *bytes = &reader->data[reader->offset];
+  size_t left = reader->length - reader->offset;
+  if(left == 0){
+    return PARSE_END;
+  }
+  if(left < 4){
+    return PARSE_ERROR_RECORD;
+  }
+  game->size = bytes[0];
+  game->result = (signed char) bytes[2];
+  game->count = bytes[3];
+  game->start_length = 0;
+  if(game->size < MIN_BOARD_SIZE || game->size > MAX_BOARD_SIZE ||
+    game->size % 2 != 0 || game->count > GAME_MAX_MOVES){
+    return PARSE_ERROR_RECORD;
+  }
+  size_t length = 4;
+  if(bytes[1] & GAME_CUSTOM_START){
+    /* the record length is known once it is read */
+    board_t *start = board_alloc(game->size, EMPTY_DISC);
+    if(start == NULL){
+      return PARSE_ERROR_MEMORY;
+    }
+    size_t used = 0;
+    size_t available = left - length;
+    if(available > GAME_MAX_START){
+      available = GAME_MAX_START;
+    }
+    parse_error_t error = board_read_record(start, &bytes[length], available,
+      &used, NULL);
+    /* the moves are numbered on the board of the header */
+    const bool same_size = (board_size(start) == game->size);
+    board_free(start);
+    if(error != PARSE_OK || !same_size){
+      return PARSE_ERROR_RECORD;
+    }
+    memcpy(game->start, &bytes[length], used);
+    game->start_length = used;
+    length += used;
+  }
+  if(left < length + game->count){
+    return PARSE_ERROR_RECORD;
+  }
+  for(size_t i = 0; i < game->count; i++){
+    game->moves[i].row = bytes[length + i] / game->size;
+    game->moves[i].column = bytes[length + i] % game->size;
+  }
+  reader->offset += length + game->count;
+  return PARSE_OK;
+}
+
+void games_reader_close(games_reader_t *reader){
+  if(reader == NULL){
+    return;
+  }
+  munmap((void *) reader->data, reader->length);
+  free(reader);
+}
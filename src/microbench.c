@@ -0,0 +1,228 @@
+/* Microbenchmarks of the board primitives: every primitive is timed on the
+ * positions of random games of every board size, several runs in a row,
+ * and its mean time per call, the standard deviation between the runs and
+ * the cycles per call (time stamp counter, x86 only) are printed. The
+ * static kernels are reached by building board.c into the harness */
+#include "board.c"
+
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <x86intrin.h>
+#define MICROBENCH_CYCLES
+#endif
+
+/* positions of every size, each primitive is called once per position and
+ * run */
+#define MICROBENCH_POSITIONS 20000
+#define MICROBENCH_RUNS 15
+#define MICROBENCH_SEED 0x5eed
+
+/* a primitive called on count boards, moves holds a legal move of each.
+ * Returns a checksum of the results, so that no call is optimized away */
+typedef struct
+{
+  const char *name;
+  uint64_t (*run)(board_t boards[], const move_t moves[], size_t count);
+} primitive_t;
+
+static bitboard_t to_move(const board_t *board){
+  return board->player == BLACK_DISC ? board->black : board->white;
+}
+
+static bitboard_t not_to_move(const board_t *board){
+  return board->player == BLACK_DISC ? board->white : board->black;
+}
+
+static uint64_t run_compute_moves(board_t boards[], const move_t moves[],
+  size_t count){
+  (void) moves;
+  uint64_t sum = 0;
+  for(size_t i = 0; i < count; i++){
+    bitboard_t result = compute_moves(boards[i].context, to_move(&boards[i]),
+      not_to_move(&boards[i]));
+    sum += result.word[0] ^ result.word[BOARD_WORDS - 1];
+  }
+  return sum;
+}
+
+static uint64_t run_board_play(board_t boards[], const move_t moves[],
+  size_t count){
+  uint64_t sum = 0;
+  for(size_t i = 0; i < count; i++){
+    sum += board_play(&boards[i], moves[i]);
+  }
+  return sum;
+}
+
+static uint64_t run_board_check_end(board_t boards[], const move_t moves[],
+  size_t count){
+  (void) moves;
+  uint64_t sum = 0;
+  for(size_t i = 0; i < count; i++){
+    board_check_end(&boards[i]);
+    sum += boards[i].player;
+  }
+  return sum;
+}
+
+static uint64_t run_board_frontiers(board_t boards[], const move_t moves[],
+  size_t count){
+  (void) moves;
+  uint64_t sum = 0;
+  for(size_t i = 0; i < count; i++){
+    sum += board_frontiers(&boards[i], boards[i].player);
+  }
+  return sum;
+}
+
+static uint64_t run_board_stable(board_t boards[], const move_t moves[],
+  size_t count){
+  (void) moves;
+  uint64_t sum = 0;
+  for(size_t i = 0; i < count; i++){
+    sum += board_stable(&boards[i], boards[i].player);
+  }
+  return sum;
+}
+
+static uint64_t run_board_node_features(board_t boards[],
+  const move_t moves[], size_t count){
+  (void) moves;
+  uint64_t sum = 0;
+  for(size_t i = 0; i < count; i++){
+    board_node_t node;
+    board_features_t features;
+    board_node_init(&node, &boards[i]);
+    board_node_features(boards[i].context, &node, &features);
+    sum += features.stable + features.disc_evaluation;
+  }
+  return sum;
+}
+
+static uint64_t run_board_evaluat_discs(board_t boards[],
+  const move_t moves[], size_t count){
+  (void) moves;
+  uint64_t sum = 0;
+  for(size_t i = 0; i < count; i++){
+    sum += board_evaluat_discs(&boards[i], boards[i].player);
+  }
+  return sum;
+}
+
+static uint64_t run_bitboard_popcount(board_t boards[], const move_t moves[],
+  size_t count){
+  (void) moves;
+  uint64_t sum = 0;
+  for(size_t i = 0; i < count; i++){
+    sum += bitboard_popcount(boards[i].black, boards[i].context->words);
+  }
+  return sum;
+}
+
+static uint64_t run_board_random_playout(board_t boards[],
+  const move_t moves[], size_t count){
+  (void) moves;
+  uint64_t sum = 0;
+  for(size_t i = 0; i < count; i++){
+    score_t score = board_random_playout(&boards[i]);
+    sum += score.black - score.white;
+  }
+  return sum;
+}
+
+static const primitive_t primitives[] = {
+  { "compute_moves", run_compute_moves },
+  { "board_play", run_board_play },
+  { "board_check_end", run_board_check_end },
+  { "board_frontiers", run_board_frontiers },
+  { "board_stable", run_board_stable },
+  { "board_node_features", run_board_node_features },
+  { "board_evaluat_discs", run_board_evaluat_discs },
+  { "bitboard_popcount", run_bitboard_popcount },
+  { "board_random_playout", run_board_random_playout }
+};
+
+/* fills boards with the positions of random games of size where the
+ * player to move has a move, and moves with one of them */
+static void corpus_fill(size_t size, board_t boards[], move_t moves[]){
+  size_t count = 0;
+  rng_seed(MICROBENCH_SEED + size);
+  while(count < MICROBENCH_POSITIONS){
+    board_t *board = board_init(size);
+    while(board->player != EMPTY_DISC && count < MICROBENCH_POSITIONS){
+      move_t move = board_random_move(board);
+      boards[count] = *board;
+      moves[count] = move;
+      count++;
+      board_play(board, move);
+    }
+    board_free(board);
+  }
+}
+
+static double now(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + (time.tv_nsec / 1e9);
+}
+
+static uint64_t cycles(void){
+#ifdef MICROBENCH_CYCLES
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+int main(void){
+  board_t *corpus = malloc(MICROBENCH_POSITIONS * sizeof(board_t));
+  board_t *boards = malloc(MICROBENCH_POSITIONS * sizeof(board_t));
+  move_t *moves = malloc(MICROBENCH_POSITIONS * sizeof(move_t));
+  if(corpus == NULL || boards == NULL || moves == NULL){
+    fprintf(stderr, "microbench: error: out of memory\n");
+    return EXIT_FAILURE;
+  }
+  uint64_t checksum = 0;
+  printf("%d positions per size, %d runs\n", MICROBENCH_POSITIONS,
+    MICROBENCH_RUNS);
+  printf("size  primitive               ns/call    stddev  cycles/call\n");
+  for(size_t size = 4; size <= MAX_BOARD_SIZE; size += 2){
+    corpus_fill(size, corpus, moves);
+    for(size_t p = 0; p < sizeof(primitives) / sizeof(primitive_t); p++){
+      double sum = 0;
+      double squares = 0;
+      double cycle_sum = 0;
+      for(int run = 0; run < MICROBENCH_RUNS; run++){
+        /* every run starts from the same positions, the primitives
+         * changing their board do not see their own results */
+        memcpy(boards, corpus, MICROBENCH_POSITIONS * sizeof(board_t));
+        const double start = now();
+        const uint64_t start_cycles = cycles();
+        checksum += primitives[p].run(boards, moves, MICROBENCH_POSITIONS);
+        const uint64_t used_cycles = cycles() - start_cycles;
+        const double ns = 1e9 * (now() - start) / MICROBENCH_POSITIONS;
+        sum += ns;
+        squares += ns * ns;
+        cycle_sum += (double) used_cycles / MICROBENCH_POSITIONS;
+      }
+      const double mean = sum / MICROBENCH_RUNS;
+      const double deviation = sqrt(fmax((squares / MICROBENCH_RUNS) -
+        (mean * mean), 0));
+      printf("%4ld  %-20s  %9.2f  %8.2f", size, primitives[p].name, mean,
+        deviation);
+#ifdef MICROBENCH_CYCLES
+      printf("  %11.1f\n", cycle_sum / MICROBENCH_RUNS);
+#else
+      printf("  %11s\n", "n/a");
+#endif
+    }
+  }
+  /* printed so that the results are used */
+  printf("checksum %lx\n", (unsigned long) checksum);
+  free(corpus);
+  free(boards);
+  free(moves);
+  return EXIT_SUCCESS;
+}
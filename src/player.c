@@ -6,12 +6,12 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <time.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <board.h>
-
-static bool random_is_initialized = false;
+#include <search.h>
+#include <solver.h>
 
 static void remove_spaces(char *s){
   int i,k = 0;
@@ -139,13 +139,6 @@ move_t human_player(board_t *board){
   return result;
 }
 
-static void random_initialize(){
-  if(!random_is_initialized){
-    srand(time(0));
-    random_is_initialized = true;
-  }
-}
-
 static int score_heuristic(board_t *board, disc_t player){
   int result;
   if(board == NULL || player == EMPTY_DISC){
@@ -161,58 +154,145 @@ static int score_heuristic(board_t *board, disc_t player){
   return result;
 }
 
-static int final_heuristic(board_t *board, disc_t player){
-  game_stage stage = stage_of_game(board);
-  int score_weight = 1;
-  int mobility_weight = 1;
-  int stable_weight = 1;
-  int disc_evaluation_weight = 1;
-  int frontiers_weight = 1;
-  switch (stage) {
-    case EARLY_GAME:
-      score_weight = 1;
-      mobility_weight = 8;
-      stable_weight = 20;
-      disc_evaluation_weight = 7;
-      frontiers_weight = 3;
-      break;
-    case MID_GAME:
-      score_weight = 3;
-      mobility_weight = 2;
-      stable_weight = 10;
-      disc_evaluation_weight = 4;
-      frontiers_weight = 3;
-      break;
-    case END_GAME:
-      score_weight = 7;
-      mobility_weight = 10;
-      stable_weight = 2;
-      disc_evaluation_weight = 1;
-      frontiers_weight = 2;
-      break;
-    case END_END_GAME:
-      score_weight = 10;
-      mobility_weight = 2;
-      stable_weight = 0;
-      disc_evaluation_weight = 0;
-      frontiers_weight = 0;
+/* weights of the features in final_heuristic for every game stage, the
+ * region weights are the disc evaluation weight of the stage times the
+ * value of the region in board_evaluat_discs. The potential mobility and
+ * parity weights are 0 until fitted by the tuner */
+static heuristic_weights_t weights[4] = {
+  /* EARLY_GAME */
+  { .score = 1, .mobility = 8, .stable = 20, .frontiers = 3,
+    .regions = { 140, -21, 77, 56, -49, -28, 7, 14 } },
+  /* MID_GAME */
+  { .score = 3, .mobility = 2, .stable = 10, .frontiers = 3,
+    .regions = { 80, -12, 44, 32, -28, -16, 4, 8 } },
+  /* END_GAME */
+  { .score = 7, .mobility = 10, .stable = 2, .frontiers = 2,
+    .regions = { 20, -3, 11, 8, -7, -4, 1, 2 } },
+  /* END_END_GAME */
+  { .score = 10, .mobility = 2, .stable = 0, .frontiers = 0,
+    .regions = { 0, 0, 0, 0, 0, 0, 0, 0 } }
+};
+
+/* names of the stages in the weights file */
+static const char *stage_names[4] = { "early", "mid", "end", "end_end" };
+
+heuristic_weights_t get_weights(game_stage stage){
+  return weights[stage];
+}
+
+void set_weights(game_stage stage, heuristic_weights_t stage_weights){
+  weights[stage] = stage_weights;
+}
+
+bool save_weights(const char *filename){
+  FILE *fd = fopen(filename, "w");
+  if(fd == NULL){
+    return false;
+  }
+  fprintf(fd, "# stage score mobility stable frontiers regions[0..7] "
+    "potential_mobility parity\n");
+  for(int stage = EARLY_GAME; stage <= END_END_GAME; stage++){
+    const heuristic_weights_t *w = &weights[stage];
+    fprintf(fd, "%s %d %d %d %d", stage_names[stage], w->score, w->mobility,
+      w->stable, w->frontiers);
+    for(int r = 0; r < 8; r++){
+      fprintf(fd, " %d", w->regions[r]);
+    }
+    fprintf(fd, " %d %d\n", w->potential_mobility, w->parity);
   }
+  return fclose(fd) == 0;
+}
 
-  int score = score_heuristic(board, player);
-  int mobility = board_mobility(board, player);
-  int stable = 0;
-  if(board_stable_is_possible(board)){
-    stable = board_stable(board, player);
+bool load_weights(const char *filename){
+  FILE *fd = fopen(filename, "r");
+  if(fd == NULL){
+    return false;
+  }
+  heuristic_weights_t loaded[4];
+  bool found[4] = { false, false, false, false };
+  char *line = NULL;
+  size_t line_size = 0;
+  bool ok = true;
+  while(ok && getline(&line, &line_size, fd) != -1){
+    char name[16];
+    heuristic_weights_t w = { 0 };
+    if(line[0] == '#' || line[0] == '\n'){
+      continue;
+    }
+    /* the last two weights came later, older files lack them */
+    const int fields = sscanf(line,
+      "%15s %d %d %d %d %d %d %d %d %d %d %d %d %d %d", name, &w.score,
+      &w.mobility, &w.stable, &w.frontiers, &w.regions[0], &w.regions[1],
+      &w.regions[2], &w.regions[3], &w.regions[4], &w.regions[5],
+      &w.regions[6], &w.regions[7], &w.potential_mobility, &w.parity);
+    if(fields != 13 && fields != 15){
+      ok = false;
+      break;
+    }
+    ok = false;
+    for(int stage = EARLY_GAME; stage <= END_END_GAME; stage++){
+      if(strcmp(name, stage_names[stage]) == 0){
+        loaded[stage] = w;
+        found[stage] = true;
+        ok = true;
+      }
+    }
+  }
+  free(line);
+  fclose(fd);
+  for(int stage = EARLY_GAME; stage <= END_END_GAME; stage++){
+    ok = ok && found[stage];
+  }
+  if(ok){
+    for(int stage = EARLY_GAME; stage <= END_END_GAME; stage++){
+      weights[stage] = loaded[stage];
+    }
   }
-  int disc_evaluation = 0;
-  if(board_size(board) == 8){
-    disc_evaluation = board_evaluat_discs(board, player);
+  return ok;
+}
+
+static int weighted_features(const heuristic_weights_t *w,
+  const board_features_t *features){
+  int result = (w->score * features->score) +
+    (w->mobility * features->mobility) +
+    (w->stable * features->stable) +
+    (w->frontiers * features->frontiers) +
+    (w->potential_mobility * features->potential_mobility) +
+    (w->parity * features->parity);
+  for(int r = 0; r < 8; r++){
+    result += w->regions[r] * features->regions[r];
   }
-  int frontiers = board_frontiers(board, player);
+  return result;
+}
 
-  return (score_weight * score) + (disc_evaluation * disc_evaluation_weight) +
-    (mobility * mobility_weight) + (stable * stable_weight) +
-    (frontiers * frontiers_weight);
+int final_heuristic(board_t *board, disc_t player){
+  board_features_t features;
+  board_features(board, player, &features);
+  return weighted_features(&weights[stage_of_game(board)], &features);
+}
+
+int final_heuristic_node(const board_context_t *context,
+  const board_node_t *node){
+  board_features_t features;
+  board_node_features(context, node, &features);
+  return weighted_features(&weights[board_node_stage(context, node)],
+    &features);
+}
+
+void final_heuristic_node_batch(const board_context_t *context,
+  const board_node_t nodes[], size_t count, int values[]){
+  board_features_t features[SEARCH_MAX_MOVES];
+  for(size_t first = 0; first < count; first += SEARCH_MAX_MOVES){
+    size_t group = count - first;
+    if(group > SEARCH_MAX_MOVES){
+      group = SEARCH_MAX_MOVES;
+    }
+    board_node_features_batch(context, &nodes[first], group, features);
+    for(size_t i = 0; i < group; i++){
+      values[first + i] = weighted_features(
+        &weights[board_node_stage(context, &nodes[first + i])], &features[i]);
+    }
+  }
 }
 
 move_t random_player(board_t *board){
@@ -220,19 +300,13 @@ move_t random_player(board_t *board){
   if(board == NULL){
     return result;
   }
-  random_initialize();
-  int r = rand() % board_count_player_moves(board);
-  result = board_next_move(board);
-  for(int i = 0; i < r; i++){
-    result = board_next_move(board);
-  }
-  return result;
+  return board_random_move(board);
 }
 
 static int minimax_help(board_t *board, size_t depth, bool maximizingPlayer,
-  disc_t player, bool ab, int a, int b, time_t timer){
+  disc_t player){
   int value = final_heuristic(board, player);
-  if(depth == 0 || (time(NULL) - timer) >= MAX_TIME){
+  if(depth == 0){
     return value;
   }
   if(board_player(board) == EMPTY_DISC){
@@ -255,25 +329,10 @@ static int minimax_help(board_t *board, size_t depth, bool maximizingPlayer,
       if(board_player(board) == board_player(new_board)){
         maximizingPlayer = true;
       }
-      int new_value;
-      if(ab){
-        new_value = minimax_help(new_board, depth - 1, maximizingPlayer,
-          player, false, a, b, timer);
-        if(new_value > value){
-          value = new_value;
-        }
-        if(value > a){
-          a = value;
-        }
-        if(a > b){
-          break;
-        }
-      } else {
-        new_value = minimax_help(new_board, depth - 1, maximizingPlayer,
-          player, false, 0, 0, timer);
-        if(new_value > value){
-          value = new_value;
-        }
+      int new_value = minimax_help(new_board, depth - 1, maximizingPlayer,
+        player);
+      if(new_value > value){
+        value = new_value;
       }
       board_free(new_board);
     }
@@ -288,25 +347,10 @@ static int minimax_help(board_t *board, size_t depth, bool maximizingPlayer,
       if(board_player(board) == board_player(new_board)){
         maximizingPlayer = true;
       }
-      int new_value;
-      if(ab){
-        new_value = minimax_help(new_board, depth - 1, maximizingPlayer,
-          player, false, a, b, timer);
-        if(new_value < value){
-          value = new_value;
-        }
-        if(value < b){
-          b = value;
-        }
-        if(a > b){
-          break;
-        }
-      } else {
-        new_value = minimax_help(new_board, depth - 1, maximizingPlayer,
-          player, false, 0, 0, timer);
-        if(new_value < value){
-          value = new_value;
-        }
+      int new_value = minimax_help(new_board, depth - 1, maximizingPlayer,
+        player);
+      if(new_value < value){
+        value = new_value;
       }
       board_free(new_board);
     }
@@ -314,14 +358,13 @@ static int minimax_help(board_t *board, size_t depth, bool maximizingPlayer,
   }
 }
 
-static move_t minimax_player_help(board_t *board, size_t depth, bool ab){
+static move_t minimax_player_help(board_t *board, size_t depth){
   move_t return_move = (move_t) { MAX_BOARD_SIZE + 1, MAX_BOARD_SIZE + 1};
   if(depth == 0 || board == NULL){
     return return_move;
   }
   int value = -MAX_INT;
   bool maximizingPlayer = false;
-  time_t timer = time(NULL);
   for(size_t i = 0; i < board_count_player_moves(board); i++){
     struct board_t *new_board = board_copy(board);
     move_t new_move = board_next_move(board);
@@ -329,15 +372,8 @@ static move_t minimax_player_help(board_t *board, size_t depth, bool ab){
     if(board_player(board) == board_player(new_board)){
       maximizingPlayer = true;
     }
-    int new_value;
-    if(ab){
-      new_value = minimax_help(new_board, depth - 1, maximizingPlayer,
-        board_player(board), true, value,
-        ((MAX_BOARD_SIZE * MAX_BOARD_SIZE) + 1), timer);
-    } else {
-      new_value = minimax_help(new_board, depth - 1, maximizingPlayer,
-        board_player(board), false, 0, 0, timer);
-    }
+    int new_value = minimax_help(new_board, depth - 1, maximizingPlayer,
+      board_player(board));
     if(new_value > value){
       return_move = new_move;
       value = new_value;
@@ -348,18 +384,90 @@ static move_t minimax_player_help(board_t *board, size_t depth, bool ab){
 }
 
 move_t minmax_player(board_t *board, size_t depth){
-  return minimax_player_help(board, depth, false);
+  return minimax_player_help(board, depth);
+}
+
+/* empties of the exact endgame of the AI players and its threads */
+static size_t endgame_empties = ENDGAME_EMPTIES;
+static size_t endgame_threads = 1;
+
+void set_endgame(size_t empties, size_t threads){
+  endgame_empties = empties;
+  endgame_threads = threads;
+}
+
+size_t get_endgame_empties(void){
+  return endgame_empties;
+}
+
+size_t get_endgame_threads(void){
+  return endgame_threads;
 }
 
 move_t minmax_ab_player(board_t *board, size_t depth){
-  return minimax_player_help(board, depth, true);
+  search_options_t options = { .depth = depth, .clock = NULL,
+    .selectivity = get_selectivity(), .reductions = true,
+    .threads = endgame_threads };
+  return search_position(board, &options).move;
 }
 
-move_t ai_player(board_t *board){
-  size_t depth = 4;
+/* time control of the AI players, a zero time plays at a fixed depth */
+static game_clock_t time_control = { 0, 0 };
+/* clocks of black and white in the game of the thread */
+static _Thread_local game_clock_t clocks[2];
+
+void set_time_control(double seconds, double increment){
+  time_control.remaining = seconds;
+  time_control.increment = increment;
+  reset_game_clocks();
+}
+
+/* nodes of every search of the AI players, 0 for no limit */
+static uint64_t node_limit = 0;
+
+void set_node_limit(uint64_t nodes){
+  node_limit = nodes;
+}
+
+void reset_game_clocks(void){
+  clocks[0] = time_control;
+  clocks[1] = time_control;
+}
+
+/* search options of the AI players, on the clock of the player to move if
+ * there is a time control */
+static search_options_t ai_options(board_t *board){
+  search_options_t options = { .depth = 4, .clock = NULL,
+    .max_nodes = node_limit, .selectivity = get_selectivity(),
+    .reductions = true, .threads = endgame_threads };
   size_t how_mayn_turns_left = turns_left(board);
-  if(how_mayn_turns_left < 10){
-    depth = how_mayn_turns_left;
+  if(time_control.remaining > 0){
+    options.depth = how_mayn_turns_left;
+    options.clock = &clocks[board_player(board) == BLACK_DISC ? 0 : 1];
+  } else if(node_limit > 0 || how_mayn_turns_left <= endgame_empties){
+    options.depth = how_mayn_turns_left;
+  }
+  return options;
+}
+
+move_t ai_player(board_t *board){
+  int value;
+  move_t move;
+  if(solver_lookup(board, &value, &move)){
+    return move;
+  }
+  search_options_t options = ai_options(board);
+  return search_position(board, &options).move;
+}
+
+move_t full_width_player(board_t *board){
+  int value;
+  move_t move;
+  if(solver_lookup(board, &value, &move)){
+    return move;
   }
-  return minmax_ab_player(board, depth);
+  search_options_t options = ai_options(board);
+  options.selectivity = 0;
+  options.reductions = false;
+  return search_position(board, &options).move;
 }
@@ -0,0 +1,211 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+/* first capacity of a queue, it doubles when full */
+#define POOL_QUEUE_CAPACITY 64
+
+typedef struct
+{
+  void (*run)(void *);
+  void *argument;
+} pool_task_t;
+
+/* Tasks of one worker, a ring buffer of capacity tasks from head on */
+typedef struct
+{
+  pthread_mutex_t lock;
+  pool_task_t *tasks;
+  size_t head;
+  size_t count;
+  size_t capacity;
+} pool_queue_t;
+
+/* A worker and the pool it steals from */
+typedef struct
+{
+  pool_t *pool;
+  size_t index;
+  pthread_t thread;
+} pool_worker_t;
+
+struct pool_t
+{
+  size_t threads;
+  pool_queue_t *queues;
+  pool_worker_t *workers;
+  /* guards next, pending and closing, idle workers wait on wake */
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  /* queue of the next submitted task */
+  size_t next;
+  /* tasks submitted and not taken yet */
+  size_t pending;
+  bool closing;
+};
+
+static bool queue_push(pool_queue_t *queue, pool_task_t task){
+  pthread_mutex_lock(&queue->lock);
+  if(queue->count == queue->capacity){
+    const size_t capacity = queue->capacity == 0 ? POOL_QUEUE_CAPACITY :
+      2 * queue->capacity;
+    pool_task_t *tasks = malloc(capacity * sizeof(pool_task_t));
+    if(tasks == NULL){
+      pthread_mutex_unlock(&queue->lock);
+      return false;
+    }
+    for(size_t i = 0; i < queue->count; i++){
+      tasks[i] = queue->tasks[(queue->head + i) % queue->capacity];
+    }
+    free(queue->tasks);
+    queue->tasks = tasks;
+    queue->head = 0;
+    queue->capacity = capacity;
+  }
+  queue->tasks[(queue->head + queue->count) % queue->capacity] = task;
+  queue->count++;
+  pthread_mutex_unlock(&queue->lock);
+  return true;
+}
+
+/* takes the oldest task of the queue, waiting for its lock only if wait is
+ * set (thieves do not queue up behind a busy owner) */
+static bool queue_pop(pool_queue_t *queue, bool wait, pool_task_t *task){
+  if(wait){
+    pthread_mutex_lock(&queue->lock);
+  } else if(pthread_mutex_trylock(&queue->lock) != 0){
+    return false;
+  }
+  const bool found = queue->count > 0;
+  if(found){
+    *task = queue->tasks[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return found;
+}
+
+/* takes a task from the own queue of the worker, else from the others */
+static bool pool_take(pool_t *pool, size_t index, pool_task_t *task){
+  if(queue_pop(&pool->queues[index], true, task)){
+    return true;
+  }
+  for(size_t i = 1; i < pool->threads; i++){
+    if(queue_pop(&pool->queues[(index + i) % pool->threads], false, task)){
+      return true;
+    }
+  }
+  return false;
+}
+
+static void *pool_work(void *argument){
+  pool_worker_t *worker = argument;
+  pool_t *pool = worker->pool;
+  while(true){
+    pthread_mutex_lock(&pool->lock);
+    while(pool->pending == 0 && !pool->closing){
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    }
+    if(pool->pending == 0){
+      pthread_mutex_unlock(&pool->lock);
+      return NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    pool_task_t task;
+    /* a pending task may still be on its way into its queue, or sit in a
+     * queue locked by a thief for a moment */
+    if(pool_take(pool, worker->index, &task)){
+      pthread_mutex_lock(&pool->lock);
+      pool->pending--;
+      pthread_mutex_unlock(&pool->lock);
+      task.run(task.argument);
+    }
+  }
+}
+
+pool_t *pool_new(size_t threads){
+  if(threads == 0){
+    threads = 1;
+  }
+  pool_t *pool = malloc(sizeof(pool_t));
+  if(pool == NULL){
+    return NULL;
+  }
+  pool->queues = calloc(threads, sizeof(pool_queue_t));
+  pool->workers = calloc(threads, sizeof(pool_worker_t));
+  if(pool->queues == NULL || pool->workers == NULL){
+    free(pool->queues);
+    free(pool->workers);
+    free(pool);
+    return NULL;
+  }
+  pool->threads = threads;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pool->next = 0;
+  pool->pending = 0;
+  pool->closing = false;
+  for(size_t i = 0; i < threads; i++){
+    pthread_mutex_init(&pool->queues[i].lock, NULL);
+  }
+  for(size_t i = 0; i < threads; i++){
+    pool->workers[i].pool = pool;
+    pool->workers[i].index = i;
+    if(pthread_create(&pool->workers[i].thread, NULL, pool_work,
+      &pool->workers[i]) != 0){
+      pool->threads = i;
+      pool_free(pool);
+      return NULL;
+    }
+  }
+  return pool;
+}
+
+bool pool_submit(pool_t *pool, void (*run)(void *), void *argument){
+  /* the task is counted before it is queued, so that pending never falls
+   * below the tasks left in the queues */
+  pthread_mutex_lock(&pool->lock);
+  const size_t index = pool->next;
+  pool->next = (pool->next + 1) % pool->threads;
+  pool->pending++;
+  pthread_mutex_unlock(&pool->lock);
+  const bool queued = queue_push(&pool->queues[index],
+    (pool_task_t) { run, argument });
+  pthread_mutex_lock(&pool->lock);
+  if(queued){
+    pthread_cond_signal(&pool->wake);
+  } else {
+    pool->pending--;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return queued;
+}
+
+size_t pool_threads(const pool_t *pool){
+  return pool->threads;
+}
+
+void pool_free(pool_t *pool){
+  pthread_mutex_lock(&pool->lock);
+  pool->closing = true;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  for(size_t i = 0; i < pool->threads; i++){
+    pthread_join(pool->workers[i].thread, NULL);
+  }
+  for(size_t i = 0; i < pool->threads; i++){
+    pthread_mutex_destroy(&pool->queues[i].lock);
+    free(pool->queues[i].tasks);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->wake);
+  free(pool->queues);
+  free(pool->workers);
+  free(pool);
+}
@@ -3,125 +3,169 @@
 #include "reversi.h"
 
 #include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <board.h>
+#include <games.h>
 #include <player.h>
+#include <rng.h>
+#include <search.h>
+#include <server.h>
+#include <solver.h>
+#include <tuner.h>
 
 static bool verbose = false;
 static size_t black_tactic = 0;
 static size_t white_tactic = 0;
+static games_writer_t *recorder = NULL;
 
-static bool isSignificant(char c){
-  return (c == EMPTY_DISC || c == BLACK_DISC || c == WHITE_DISC || c == '#');
-}
-static bool isUnsignificant(char c){
-  return (c == ' ' || c == '\n' || c == '\t');
-}
+/* random moves starting every self play game, so that the games differ */
+#define OPENING_RANDOM_PLIES 6
+
+/* default depth of the analysis, which solves the end of the game exactly
+ * from ANALYSIS_EXACT_EMPTIES empty squares on */
+#define ANALYSIS_DEPTH 6
+#define ANALYSIS_EXACT_EMPTIES 12
+
+static bool analysis = false;
+static size_t analysis_depth = ANALYSIS_DEPTH;
+
+/* Contest answers under a deadline, counted from the start of main:
+ * DEADLINE_RESERVE_MS are kept for the start of the process before main
+ * and its exit after the answer. The search is stopped at DEADLINE_SOFT of
+ * the time left, and a watchdog answers at the end of it with the best
+ * move so far whatever the search is doing */
+#define DEADLINE_RESERVE_MS 5
+#define DEADLINE_SOFT 0.8
+/* milliseconds between two looks at the search */
+#define DEADLINE_POLL_MS 1
+
+static struct timespec process_start;
 
 static board_t *file_parser(const char *filename){
-  disc_t player = EMPTY_DISC;
-  ssize_t read;
-  int whatline = 0;
-  size_t rows = 0;
-  size_t size = 1;
-  char board_string[MAX_BOARD_SIZE * MAX_BOARD_SIZE] = "";
   FILE *inputfile = fopen(filename, "r");
-
   if(!inputfile){
     fprintf(stderr, "reversi: error: Could not open the file %s\n", filename);
     exit(EXIT_FAILURE);
   }
-  /* Getting first line */
-  char *line = NULL;
-  size_t line_size = 0;
+  /* Reading the whole file */
+  char *text = NULL;
+  size_t length = 0;
+  FILE *stream = open_memstream(&text, &length);
+  char buffer[BUFSIZ];
+  size_t read;
+  while(stream != NULL &&
+    (read = fread(buffer, 1, sizeof(buffer), inputfile)) > 0){
+    fwrite(buffer, 1, read, stream);
+  }
+  fclose(inputfile);
+  if(stream == NULL || fclose(stream) != 0){
+    fprintf(stderr, "reversi: error: Could not read the file %s\n", filename);
+    exit(EXIT_FAILURE);
+  }
 
-  /* Reading */
-  while((read = getline(&line, &line_size, inputfile)) != -1){
-    if(line[0] == '\0'){
-      continue;
-    }
-    whatline++;
-    size_t row_size = 0;
-    for(int i = 0; i < read; i++){
-      if(isSignificant(line[i])){
-        if(line[i] == '#'){
-          break;
-        }
-        if(player == EMPTY_DISC){
-          if(line[i] == BLACK_DISC || line[i] == WHITE_DISC){
-            player = line[i];
-          } else {
-            fprintf(stderr, "reversi: error: player incorrect or missing\n");
-            exit(EXIT_FAILURE);
-          }
-        } else {
-          row_size++;
-          char tmp[2];
-        	tmp[0] = line[i];
-        	tmp[1] = '\0';
-          strcat(board_string, tmp);
-        }
-      } else if(isUnsignificant(line[i])){
-        continue;
+  board_t *reversi = NULL;
+  parse_info_t info;
+  parse_error_t error = board_parse(text, length, &reversi, &info);
+  free(text);
+  switch (error){
+    case PARSE_OK:
+    case PARSE_END:
+      break;
+    case PARSE_ERROR_PLAYER:
+      fprintf(stderr, "reversi: error: player incorrect or missing\n");
+      break;
+    case PARSE_ERROR_CHARACTER:
+      fprintf(stderr, "reversi: error: wrong character '%c' at line %ld.\n",
+        info.character, info.line);
+      break;
+    case PARSE_ERROR_ROW:
+    case PARSE_ERROR_RECORD:
+      fprintf(stderr,
+        "reversi: error: row %ld is malformated!(wrong number of columns)\n",
+        info.line);
+      break;
+    case PARSE_ERROR_ROWS:
+      if(info.rows > info.size){
+        fprintf(stderr, "reversi: error: board has %ld extra row(s)\n",
+          (info.rows - info.size));
       } else {
-        fprintf(stderr, "reversi: error: wrong character '%c' at line %d.\n",
-        line[i], whatline);
-        exit(EXIT_FAILURE);
-      }
-    }
-    if(row_size == 0){
-      continue;
-    }
-    if(row_size >= MIN_BOARD_SIZE && row_size <= MAX_BOARD_SIZE &&
-      row_size % 2 == 0){
-      rows++;
-      if(size == 1){
-        size = row_size;
-      } else if(size != row_size){
-        fprintf(stderr,
-          "reversi: error: row %d is malformated!(wrong number of columns)",
-        whatline);
-        exit(EXIT_FAILURE);
+        fprintf(stderr, "reversi: error: board has %ld missing row(s)\n",
+          (info.size - info.rows));
       }
-    } else {
-      fprintf(stderr,
-        "reversi: error: row %d is malformated!(wrong number of columns)\n",
-      whatline);
-      exit(EXIT_FAILURE);
-    }
+      break;
+    case PARSE_ERROR_MEMORY:
+      fprintf(stderr, "reversi: error: out of memory\n");
+      break;
   }
-  if(rows != size){
-    if(rows > size){
-      fprintf(stderr, "reversi: error: board has %ld extra row(s)\n",
-      (rows-size));
-    } else {
-      fprintf(stderr, "reversi: error: board has %ld missing row(s)\n",
-      (size-rows));
-    }
+  if(reversi == NULL){
     exit(EXIT_FAILURE);
+  }
+  return reversi;
+}
 
+/* scores every legal move of board */
+static search_result_t analyze(board_t *board){
+  size_t depth = analysis_depth;
+  if(turns_left(board) <= ANALYSIS_EXACT_EMPTIES){
+    depth = turns_left(board);
   }
-  fclose(inputfile);
-  if(line){
-    free(line);
-  }
-  struct board_t *reversi = board_alloc(size, player, true);
-  int pointer = 0;
-  for(size_t row = 0; row < size; ++row){
-    for(size_t column = 0; column < size; ++column){
-      board_set(reversi, board_string[pointer], row, column);
-      pointer++;
+  search_options_t options = { .depth = depth, .clock = NULL,
+    .selectivity = get_selectivity(), .reductions = true, .analysis = true,
+    .threads = get_endgame_threads() };
+  return search_position(board, &options);
+}
+
+/* writes a score into text, a proven result as '=' and the final disc
+ * difference */
+static void format_score(const search_result_t *result, int score,
+  char *text, size_t length){
+  if(score >= SEARCH_WIN){
+    snprintf(text, length, "=%+d", score - SEARCH_WIN);
+  } else if(score <= -SEARCH_WIN){
+    snprintf(text, length, "=%+d", score + SEARCH_WIN);
+  } else if(result->exact){
+    snprintf(text, length, "=%+d", score);
+  } else {
+    snprintf(text, length, "%+d", score);
+  }
+}
+
+/* prints the board with the score of every legal move in its square */
+static void print_analysis(board_t *board, const search_result_t *result,
+  FILE *fd){
+  const size_t size = board_size(board);
+  fprintf(fd, "\n  ");
+  for(size_t column = 0; column < size; column++){
+    fprintf(fd, "%6c", (char) column + 'A');
+  }
+  fprintf(fd, "\n");
+  for(size_t row = 0; row < size; row++){
+    fprintf(fd, "%2ld", row + 1);
+    for(size_t column = 0; column < size; column++){
+      char text[16] = { (char) board_get(board, row, column), '\0' };
+      for(size_t i = 0; i < result->scored; i++){
+        if(result->scores[i].move.row == row &&
+          result->scores[i].move.column == column){
+          format_score(result, result->scores[i].score, text, sizeof(text));
+        }
+      }
+      fprintf(fd, "%6s", text);
     }
+    fprintf(fd, "\n");
   }
-  board_check_end(reversi);
-  board_compute_stable_pieces(reversi);
-  return reversi;
+  fprintf(fd, "\nAnalysis at depth %ld, best move %c%ld ('=' marks final disc "
+    "differences)\n", result->depth, (char) result->move.column + 'a',
+    result->move.row + 1);
 }
 
 static int game(move_t (*black)(board_t*),
@@ -137,6 +181,9 @@ static int game(move_t (*black)(board_t*),
     case 2:
       black_player = "AI";
       break;
+    case 3:
+      black_player = "full width AI";
+      break;
   }
   switch (white_tactic){
     case 0:
@@ -145,6 +192,9 @@ static int game(move_t (*black)(board_t*),
     case 2:
       white_player = "AI";
       break;
+    case 3:
+      white_player = "full width AI";
+      break;
   }
   printf("%s\n", "Welcome to the best reversi game you will ever play!");
   printf("Black player (X) is %s and white player (O) is %s\n",
@@ -157,11 +207,19 @@ static int game(move_t (*black)(board_t*),
   } else if(board_player(board) == BLACK_DISC){
     printf("%s player starts!\n", "Black");
   }
+  game_record_t record;
+  if(recorder != NULL){
+    game_record_init(&record, board);
+  }
   disc_t current_player = EMPTY_DISC;
   while(board_player(board) != EMPTY_DISC){
     current_player = board_player(board);
     move_t move;
     board_print(board, stdout);
+    if(analysis){
+      search_result_t result = analyze(board);
+      print_analysis(board, &result, stdout);
+    }
     if(current_player == BLACK_DISC){
       move = (*black)(board);
     } else {
@@ -172,6 +230,9 @@ static int game(move_t (*black)(board_t*),
         resigned = true;
       }
     } else {
+      if(recorder != NULL){
+        game_record_add(&record, move);
+      }
       if(verbose){
         printf("\nMove %c%ld was played by player %c\n",
           (char) move.column + 'a',move.row + 1, current_player);
@@ -179,6 +240,10 @@ static int game(move_t (*black)(board_t*),
     }
   }
   if(board_count_player_moves(board) == 0){
+    if(recorder != NULL){
+      game_record_finish(&record, board);
+      games_writer_append(recorder, &record);
+    }
     score_t score = board_score(board);
     if(score.black > score.white){
       printf("Player '%c' wins the game.\n", BLACK_DISC);
@@ -210,23 +275,348 @@ static int game(move_t (*black)(board_t*),
   return result;
 }
 
+/* Silent games between two program tactics, shared by the threads */
+typedef struct
+{
+  move_t (*black)(board_t *);
+  move_t (*white)(board_t *);
+  size_t size;
+  size_t games;
+  /* every game draws its random moves from seed plus its number, so that
+   * the games do not depend on the thread playing them */
+  bool seeded;
+  uint64_t seed;
+  atomic_size_t next;
+  /* games recorded so far, seeded games are recorded in their order */
+  size_t written;
+  pthread_mutex_t lock;
+  pthread_cond_t turn;
+  /* draws, black wins and white wins */
+  atomic_size_t results[3];
+} self_play_t;
+
+/* records game number game, if there is one, once all the games before it
+ * are */
+static void record_in_order(self_play_t *self_play, size_t game,
+  const game_record_t *record){
+  pthread_mutex_lock(&self_play->lock);
+  while(self_play->written != game){
+    pthread_cond_wait(&self_play->turn, &self_play->lock);
+  }
+  if(record != NULL){
+    games_writer_append(recorder, record);
+  }
+  self_play->written++;
+  pthread_cond_broadcast(&self_play->turn);
+  pthread_mutex_unlock(&self_play->lock);
+}
+
+static void *self_play_worker(void *argument){
+  self_play_t *self_play = argument;
+  size_t game;
+  while((game = atomic_fetch_add(&self_play->next, 1)) < self_play->games){
+    board_t *board = board_init(self_play->size);
+    if(board == NULL){
+      if(recorder != NULL && self_play->seeded){
+        record_in_order(self_play, game, NULL);
+      }
+      break;
+    }
+    if(self_play->seeded){
+      rng_seed(self_play->seed + game);
+    }
+    reset_game_clocks();
+    game_record_t record;
+    game_record_init(&record, board);
+    for(size_t ply = 0; ply < OPENING_RANDOM_PLIES &&
+      board_player(board) != EMPTY_DISC; ply++){
+      move_t move = random_player(board);
+      board_play(board, move);
+      game_record_add(&record, move);
+    }
+    while(board_player(board) != EMPTY_DISC){
+      move_t move;
+      if(board_player(board) == BLACK_DISC){
+        move = self_play->black(board);
+      } else {
+        move = self_play->white(board);
+      }
+      if(!board_play(board, move)){
+        break;
+      }
+      game_record_add(&record, move);
+    }
+    game_record_finish(&record, board);
+    if(recorder != NULL && self_play->seeded){
+      record_in_order(self_play, game, &record);
+    } else if(recorder != NULL){
+      games_writer_append(recorder, &record);
+    }
+    if(record.result > 0){
+      atomic_fetch_add(&self_play->results[1], 1);
+    } else if(record.result < 0){
+      atomic_fetch_add(&self_play->results[2], 1);
+    } else {
+      atomic_fetch_add(&self_play->results[0], 1);
+    }
+    board_free(board);
+  }
+  return NULL;
+}
+
+static void self_play_games(self_play_t *self_play, size_t threads){
+  pthread_t workers[threads];
+  /* the games are taken from a shared counter, so the threads which
+   * started play the games of those which could not */
+  size_t started = 1;
+  while(started < threads && pthread_create(&workers[started], NULL,
+    self_play_worker, self_play) == 0){
+    started++;
+  }
+  self_play_worker(self_play);
+  for(size_t t = 1; t < started; t++){
+    pthread_join(workers[t], NULL);
+  }
+  printf("%ld games: black (X) won %ld, white (O) won %ld, %ld draws\n",
+    self_play->games, atomic_load(&self_play->results[1]),
+    atomic_load(&self_play->results[2]),
+    atomic_load(&self_play->results[0]));
+}
+
+/* replays the games of a game file and writes every position, labeled with
+ * the final score of its game, to a binary position file */
+static bool extract_positions(const char *games_file,
+  const char *positions_file){
+  games_reader_t *reader = games_reader_open(games_file);
+  if(reader == NULL){
+    fprintf(stderr, "reversi: error: Could not read the games of %s\n",
+      games_file);
+    return false;
+  }
+  FILE *output = fopen(positions_file, "w");
+  if(output == NULL){
+    fprintf(stderr, "reversi: error: Could not open the file %s\n",
+      positions_file);
+    games_reader_close(reader);
+    return false;
+  }
+  fputs(POSITIONS_MAGIC, output);
+  static game_record_t game;
+  unsigned char record[GAME_MAX_START];
+  size_t games = 0;
+  size_t positions = 0;
+  parse_error_t error;
+  bool ok = true;
+  while(ok && (error = games_reader_next(reader, &game)) == PARSE_OK){
+    board_t *board = game_record_start(&game);
+    if(board == NULL){
+      break;
+    }
+    for(size_t i = 0; ok && i < game.count; i++){
+      fwrite(record, 1, board_write_record(board, game.result, record),
+        output);
+      positions++;
+      if(!board_play(board, game.moves[i])){
+        fprintf(stderr, "reversi: error: illegal move in game %ld\n",
+          games + 1);
+        ok = false;
+      }
+    }
+    board_free(board);
+    games++;
+  }
+  if(ok && error != PARSE_END){
+    fprintf(stderr, "reversi: error: game %ld is malformated\n", games + 1);
+    ok = false;
+  }
+  games_reader_close(reader);
+  if(fclose(output) != 0){
+    ok = false;
+  }
+  if(verbose){
+    printf("%ld positions extracted from %ld games\n", positions, games);
+  }
+  return ok;
+}
+
+/* milliseconds since the start of main */
+static double since_start_ms(void){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((now.tv_sec - process_start.tv_sec) * 1e3) +
+    ((now.tv_nsec - process_start.tv_nsec) / 1e6);
+}
+
+/* prints the contest answer: every scored move with the analysis option,
+ * else the best move, or the fallback move before the first iteration */
+static void contest_print(const search_result_t *result, move_t fallback){
+  if(result->scored > 0){
+    for(size_t i = 0; i < result->scored; i++){
+      char text[16];
+      format_score(result, result->scores[i].score, text, sizeof(text));
+      printf("%c%ld %s\n", (char) result->scores[i].move.column + 'a',
+        result->scores[i].move.row + 1, text);
+    }
+  } else {
+    move_t move = result->depth > 0 ? result->move : fallback;
+    printf("%c%ld\n", (char) move.column + 'a', move.row + 1);
+  }
+  fflush(stdout);
+}
+
+/* Contest answer given once, by the search or by the watchdog */
+typedef struct
+{
+  search_handle_t *search;
+  move_t fallback;
+  /* milliseconds since the start at which the watchdog answers */
+  double hard;
+  pthread_mutex_t lock;
+  pthread_cond_t answered_cond;
+  bool answered;
+} contest_t;
+
+/* answers with the best move so far once the hard limit has passed, and
+ * ends the process at once, the search may still be running */
+static void *contest_watchdog(void *argument){
+  contest_t *contest = argument;
+  const double wait = fmax(contest->hard - since_start_ms(), 0);
+  struct timespec limit;
+  clock_gettime(CLOCK_MONOTONIC, &limit);
+  limit.tv_sec += (time_t) (wait / 1e3);
+  limit.tv_nsec += (long) (fmod(wait, 1e3) * 1e6);
+  if(limit.tv_nsec >= 1000000000){
+    limit.tv_sec++;
+    limit.tv_nsec -= 1000000000;
+  }
+  pthread_mutex_lock(&contest->lock);
+  while(!contest->answered && pthread_cond_timedwait(&contest->answered_cond,
+    &contest->lock, &limit) == 0){
+  }
+  if(!contest->answered){
+    search_result_t result;
+    search_poll(contest->search, &result);
+    contest_print(&result, contest->fallback);
+    _exit(EXIT_SUCCESS);
+  }
+  pthread_mutex_unlock(&contest->lock);
+  return NULL;
+}
+
+/* answers the contest within deadline milliseconds of the start: a legal
+ * move is at hand before the search starts, the iterative deepening
+ * search is stopped well before the deadline and the watchdog answers
+ * alone if the search does not return in time */
+static void contest_deadline(board_t *board, double deadline){
+  contest_t contest;
+  board_t *copy = board_copy(board);
+  contest.fallback = board_next_move(copy);
+  board_free(copy);
+  contest.hard = deadline - DEADLINE_RESERVE_MS;
+  const double soft = since_start_ms() +
+    (DEADLINE_SOFT * (contest.hard - since_start_ms()));
+  search_options_t options = { .depth = turns_left(board), .clock = NULL,
+    .selectivity = get_selectivity(), .reductions = true,
+    .analysis = analysis, .threads = get_endgame_threads() };
+  search_result_t result;
+  contest.search = search_start(board, &options);
+  if(contest.search == NULL){
+    result.depth = 0;
+    result.scored = 0;
+    contest_print(&result, contest.fallback);
+    return;
+  }
+  pthread_mutex_init(&contest.lock, NULL);
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(&contest.answered_cond, &attributes);
+  pthread_condattr_destroy(&attributes);
+  contest.answered = false;
+  /* without a watchdog the answer waits for the search, which is still
+   * stopped at the soft limit */
+  pthread_t watchdog;
+  const bool guarded = pthread_create(&watchdog, NULL, contest_watchdog,
+    &contest) == 0;
+  const struct timespec poll = { 0, DEADLINE_POLL_MS * 1000000 };
+  while(!search_poll(contest.search, &result) && since_start_ms() < soft){
+    nanosleep(&poll, NULL);
+  }
+  search_stop(contest.search);
+  result = search_wait(contest.search);
+  pthread_mutex_lock(&contest.lock);
+  if(!contest.answered){
+    contest_print(&result, contest.fallback);
+    contest.answered = true;
+    pthread_cond_signal(&contest.answered_cond);
+  }
+  pthread_mutex_unlock(&contest.lock);
+  if(guarded){
+    pthread_join(watchdog, NULL);
+  }
+  pthread_mutex_destroy(&contest.lock);
+  pthread_cond_destroy(&contest.answered_cond);
+}
+
 int main(int argc, char * const argv[]){
+  clock_gettime(CLOCK_MONOTONIC, &process_start);
   size_t board_size = 8;
   bool contest_mode = false;
+  double deadline = 0;
+  size_t perft_depth = 0;
+  size_t playout_count = 0;
+  char *tune_file = NULL;
+  char *extract_file = NULL;
+  size_t self_play_count = 0;
+  char *fit_file = NULL;
+  char *benchmark_file = NULL;
+  char *solve_file = NULL;
+  char *server_socket = NULL;
+  size_t search_depth = 0;
+  double game_time = 0;
+  double increment = 0;
+  bool seeded = false;
+  uint64_t seed = 0;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
 
-  move_t (*tactics[3]) (board_t *board);
+  move_t (*tactics[4]) (board_t *board);
   tactics[0] = human_player;
   tactics[1] = random_player;
   tactics[2] = ai_player;
+  tactics[3] = full_width_player;
 
   int optc;
-  char* opts = "s:b::w::cvVh";
+  char* opts = "s:b::w::cL:p:O:t:W:j:r:g:x:S:P:f:B:d:T:I:n:R:H:Z:D:Y:E:avVh";
 
   struct option long_opts[] = {
     { "size", required_argument, NULL, 's' },
     { "black-ai", optional_argument, NULL, 'b' },
     { "white-ai", optional_argument, NULL, 'w' },
     { "contest", no_argument, NULL, 'c' },
+    { "deadline-ms", required_argument, NULL, 'L' },
+    { "perft", required_argument, NULL, 'p' },
+    { "playouts", required_argument, NULL, 'O' },
+    { "tune", required_argument, NULL, 't' },
+    { "weights", required_argument, NULL, 'W' },
+    { "threads", required_argument, NULL, 'j' },
+    { "endgame", required_argument, NULL, 'E' },
+    { "record", required_argument, NULL, 'r' },
+    { "games", required_argument, NULL, 'g' },
+    { "extract", required_argument, NULL, 'x' },
+    { "selectivity", required_argument, NULL, 'S' },
+    { "probcut", required_argument, NULL, 'P' },
+    { "fit-probcut", required_argument, NULL, 'f' },
+    { "benchmark", required_argument, NULL, 'B' },
+    { "depth", required_argument, NULL, 'd' },
+    { "time", required_argument, NULL, 'T' },
+    { "increment", required_argument, NULL, 'I' },
+    { "nodes", required_argument, NULL, 'n' },
+    { "seed", required_argument, NULL, 'R' },
+    { "hash", required_argument, NULL, 'H' },
+    { "solve", required_argument, NULL, 'Z' },
+    { "database", required_argument, NULL, 'D' },
+    { "server", required_argument, NULL, 'Y' },
+    { "analyze", no_argument, NULL, 'a' },
     { "verbose", no_argument, NULL, 'v' },
     { "version", no_argument, NULL, 'V' },
     { "help", no_argument, NULL, 'h' },
@@ -236,18 +626,19 @@ int main(int argc, char * const argv[]){
   while((optc = getopt_long(argc, argv, opts, long_opts, NULL)) != -1){
     switch(optc){
       case 's':
-        if(atoi(optarg) >= 1 && atoi(optarg) <= 5){
+        if(atoi(optarg) >= 1 && atoi(optarg) <= MAX_BOARD_SIZE / 2){
           board_size = atoi(optarg) * 2;
           printf("Your size is now: %ld.\n", board_size);
         } else {
-          printf("Your size was not right, it has to be an int between 1 and 5\n");
+          printf("Your size was not right, it has to be an int between 1 and %d\n",
+            MAX_BOARD_SIZE / 2);
           return EXIT_FAILURE;
         }
         break;
 
       case 'b':
         if(optarg == NULL) break;
-        if(atoi(optarg) >= 0 && atoi(optarg) <= 2){
+        if(atoi(optarg) >= 0 && atoi(optarg) <= 3){
           black_tactic = atoi(optarg);
           printf("Black plays now with tactic '%s'.\n", optarg);
         } else {
@@ -258,7 +649,7 @@ int main(int argc, char * const argv[]){
 
       case 'w':
         if(optarg == NULL) break;
-        if(atoi(optarg) >= 0 && atoi(optarg) <= 2){
+        if(atoi(optarg) >= 0 && atoi(optarg) <= 3){
           white_tactic = atoi(optarg);
           printf("White plays now with tactic '%s'.\n", optarg);
         } else {
@@ -271,6 +662,182 @@ int main(int argc, char * const argv[]){
         contest_mode = true;
         break;
 
+      case 'L':
+        if(atof(optarg) > 0){
+          deadline = atof(optarg);
+        } else {
+          printf("The deadline has to be a positive number of milliseconds\n");
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'p':
+        if(atoi(optarg) >= 1){
+          perft_depth = atoi(optarg);
+        } else {
+          printf("The perft depth has to be a positive int\n");
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'O':
+        if(atoi(optarg) >= 1){
+          playout_count = atoi(optarg);
+        } else {
+          printf("The number of playouts has to be a positive int\n");
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 't':
+        tune_file = optarg;
+        break;
+
+      case 'W':
+        if(!load_weights(optarg)){
+          fprintf(stderr, "reversi: error: Could not load the weights %s\n",
+            optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'j':
+        if(atoi(optarg) >= 1){
+          threads = atoi(optarg);
+        } else {
+          printf("The number of threads has to be a positive int\n");
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'E':
+        if(atoi(optarg) >= 1){
+          set_endgame(atoi(optarg), get_endgame_threads());
+        } else {
+          printf("The endgame empties have to be a positive int\n");
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'r':
+        recorder = games_writer_open(optarg);
+        if(recorder == NULL){
+          fprintf(stderr, "reversi: error: Could not open the file %s\n",
+            optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'g':
+        if(atoi(optarg) >= 1){
+          self_play_count = atoi(optarg);
+        } else {
+          printf("The number of games has to be a positive int\n");
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'x':
+        extract_file = optarg;
+        break;
+
+      case 'S':
+        if(atoi(optarg) >= 0 && atoi(optarg) <= SEARCH_MAX_SELECTIVITY &&
+          optarg[0] >= '0' && optarg[0] <= '9'){
+          set_selectivity(atoi(optarg));
+        } else {
+          printf("The selectivity has to be an int between 0 and %d\n",
+            SEARCH_MAX_SELECTIVITY);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'P':
+        if(!probcut_load(optarg)){
+          fprintf(stderr,
+            "reversi: error: Could not load the ProbCut parameters %s\n",
+            optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'f':
+        fit_file = optarg;
+        break;
+
+      case 'B':
+        benchmark_file = optarg;
+        break;
+
+      case 'd':
+        if(atoi(optarg) >= 1){
+          search_depth = atoi(optarg);
+        } else {
+          printf("The search depth has to be a positive int\n");
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'T':
+        if(atof(optarg) > 0){
+          game_time = atof(optarg);
+        } else {
+          printf("The game time has to be a positive number of seconds\n");
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'I':
+        if(atof(optarg) >= 0){
+          increment = atof(optarg);
+        } else {
+          printf("The increment has to be a number of seconds\n");
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'n':
+        if(atol(optarg) >= 1){
+          set_node_limit(atol(optarg));
+        } else {
+          printf("The node limit has to be a positive int\n");
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'R':
+        seed = strtoull(optarg, NULL, 0);
+        seeded = true;
+        break;
+
+      case 'H':
+        if(!search_open_table(optarg)){
+          fprintf(stderr,
+            "reversi: error: Could not map the table file %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'Z':
+        solve_file = optarg;
+        break;
+
+      case 'D':
+        if(!solver_load(optarg)){
+          fprintf(stderr, "reversi: error: Could not load the database %s\n",
+            optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+
+      case 'Y':
+        server_socket = optarg;
+        break;
+
+      case 'a':
+        analysis = true;
+        break;
+
       case 'v':
         verbose = true;
         printf("You set the global variable verbose to true.\n");
@@ -283,18 +850,65 @@ int main(int argc, char * const argv[]){
 
       case 'h':
         printf(
-          "Usage: reversi [-s SIZE|-b [N] |-w [N]|-c|-v|-V|-h] [FILE]\n"
+          "Usage: reversi [-s SIZE|-b [N] |-w [N]|-c|-L MS|-p DEPTH|-O N|\n"
+          "               -t FILE|-W FILE|-j N|-E N|-r FILE|-g N|-x FILE|\n"
+          "               -S N|-P FILE|-f FILE|-B FILE|-d DEPTH|-T SECONDS|\n"
+          "               -I SECONDS|-n NODES|-R SEED|-H FILE|-Z FILE|\n"
+          "               -D FILE|-Y SOCKET|-a|-v|-V|-h] [FILE]\n"
           "Play a reversi game with human or program players\n"
-          "-s, --size SIZE\t\tboard size(min=1, max=5(default=4))\n"
+          "-s, --size SIZE\t\tboard size(min=1, max=8(default=4))\n"
           "-b, --black-ai [N]\t\tset tactic of black player(default: 0)\n"
           "-w, --white-ai [N]\t\tset tactic of white player(default: 0)\n"
           "-c, --contest\t\t\tenable 'contest' mode\n"
+          "-L, --deadline-ms MS\t\tanswer the contest within MS milliseconds\n"
+          "\t\t\t\tof the start, searching as deep as they allow\n"
+          "-p, --perft DEPTH\t\tcount the move tree leaves up to DEPTH\n"
+          "-O, --playouts N\t\tplay N random games to the end from the\n"
+          "\t\t\t\tboard and report their rate and results\n"
+          "-t, --tune FILE\t\t\tfit the evaluation to the labeled positions\n"
+          "\t\t\t\tof FILE, write the weights to [FILE]\n"
+          "\t\t\t\t(default: weights.txt)\n"
+          "-W, --weights FILE\t\tload the evaluation weights from FILE\n"
+          "-j, --threads N\t\t\tnumber of threads(default: all cores)\n"
+          "-E, --endgame N\t\t\tsolve the game exactly from N empty\n"
+          "\t\t\t\tsquares on, on the -j threads (default: %d)\n"
+          "-r, --record FILE\t\tappend the finished games to FILE\n"
+          "-g, --games N\t\t\tplay N silent games between the tactics\n"
+          "-x, --extract FILE\t\twrite the labeled positions of the games\n"
+          "\t\t\t\tof FILE to [FILE] (default: positions.bin)\n"
+          "-S, --selectivity N\t\tProbCut level of the ai, 0 (default) to 5\n"
+          "-P, --probcut FILE\t\tload the ProbCut parameters from FILE\n"
+          "-f, --fit-probcut FILE\t\tfit the ProbCut parameters to the\n"
+          "\t\t\t\tpositions of FILE, write them to [FILE]\n"
+          "\t\t\t\t(default: probcut.txt)\n"
+          "-B, --benchmark FILE\t\tcompare the selectivity levels on the\n"
+          "\t\t\t\tpositions of FILE\n"
+          "-d, --depth DEPTH\t\tsearch depth of -f, -B and -a\n"
+          "\t\t\t\t(default: 8, 6, 6)\n"
+          "-T, --time SECONDS\t\tgame clock of each ai, which then searches\n"
+          "\t\t\t\tas deep as its time allows\n"
+          "-I, --increment SECONDS\tseconds added to the clock every move\n"
+          "-n, --nodes NODES\t\tnodes of every search of the ai, which then\n"
+          "\t\t\t\tsearches as deep as they allow\n"
+          "-R, --seed SEED\t\t\tseed of the random moves, the same seed\n"
+          "\t\t\t\tand node limit replay the same games\n"
+          "-H, --hash FILE\t\t\tshare the transposition table of FILE with\n"
+          "\t\t\t\tthe other processes using it, and keep it\n"
+          "\t\t\t\tfor the next ones (e.g. contest runs)\n"
+          "-Z, --solve FILE\t\tsolve every position of the game from [FILE]\n"
+          "\t\t\t\tor the start (up to -d moves deep, then by\n"
+          "\t\t\t\tsearch) and write them to the database FILE\n"
+          "-D, --database FILE\t\tplay the solved moves of the database FILE\n"
+          "-Y, --server SOCKET\t\thost games on the local socket SOCKET,\n"
+          "\t\t\t\tthe ai playing on the -j threads\n"
+          "-a, --analyze\t\t\tscore every legal move on the board and in\n"
+          "\t\t\t\tthe contest answer\n"
           "-v, --verbose\t\t\tverbose output\n"
           "-V, --version\t\t\tdisplay version and exit\n"
           "-h, --help\t\t\tdisplay this help text\n"
           "\n"
-          "Tactic list: human(0) random(1) ai(2)\n"
-        );
+          "Tactic list: human(0) random(1) ai(2) full width ai(3)\n",
+          ENDGAME_EMPTIES);
         return EXIT_SUCCESS;
 
       default:
@@ -302,17 +916,162 @@ int main(int argc, char * const argv[]){
         return EXIT_FAILURE;
     }
   }
-  struct board_t *board;
-  if(contest_mode){
+  struct board_t *board = NULL;
+  if(search_depth > 0){
+    analysis_depth = search_depth;
+  }
+  if(game_time > 0){
+    set_time_control(game_time, increment);
+  }
+  if(seeded){
+    rng_seed(seed);
+  }
+  /* silent games already keep every thread busy with a game of its own */
+  if(self_play_count == 0 && threads > 1){
+    set_endgame(get_endgame_empties(), threads);
+  }
+  if(extract_file != NULL){
+    const char *positions_file = "positions.bin";
+    if(argv[optind] != NULL){
+      positions_file = argv[optind];
+    }
+    return extract_positions(extract_file, positions_file) ?
+      EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  if(self_play_count > 0){
+    if(black_tactic == 0 || white_tactic == 0){
+      printf("Silent games need two program tactics (-b N and -w N)\n");
+      return EXIT_FAILURE;
+    }
+    self_play_t self_play = { .black = tactics[black_tactic],
+      .white = tactics[white_tactic], .size = board_size,
+      .games = self_play_count, .seeded = seeded, .seed = seed };
+    atomic_init(&self_play.next, 0);
+    self_play.written = 0;
+    pthread_mutex_init(&self_play.lock, NULL);
+    pthread_cond_init(&self_play.turn, NULL);
+    for(int i = 0; i < 3; i++){
+      atomic_init(&self_play.results[i], 0);
+    }
+    self_play_games(&self_play, threads);
+    pthread_mutex_destroy(&self_play.lock);
+    pthread_cond_destroy(&self_play.turn);
+    if(recorder != NULL && !games_writer_close(recorder)){
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+  if(solve_file != NULL){
+    if(argv[optind] != NULL && access(argv[optind], F_OK) == 0){
+      board = file_parser(argv[optind]);
+    } else {
+      board = board_init(board_size);
+    }
+    bool solved = solver_build(board, search_depth > 0 ? search_depth :
+      turns_left(board), threads, solve_file, verbose);
+    board_free(board);
+    return solved ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  if(server_socket != NULL){
+    if(!server_run(server_socket, threads, verbose)){
+      fprintf(stderr, "reversi: error: Could not serve on %s (socket or "
+        "worker threads)\n", server_socket);
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+  if(fit_file != NULL){
+    const char *probcut_file = "probcut.txt";
+    if(argv[optind] != NULL){
+      probcut_file = argv[optind];
+    }
+    return probcut_fit(fit_file, probcut_file,
+      search_depth > 0 ? search_depth : 8, threads, verbose) ?
+      EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  if(benchmark_file != NULL){
+    return search_benchmark(benchmark_file,
+      search_depth > 0 ? search_depth : 6) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  if(tune_file != NULL){
+    const char *weights_file = "weights.txt";
+    if(argv[optind] != NULL){
+      weights_file = argv[optind];
+    }
+    if(!tune_weights(tune_file, weights_file, 1000, threads, verbose)){
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+  if(verbose){
+    /* the answer of the contest mode stays alone on stdout */
+    set_search_output(contest_mode ? stderr : stdout);
+  }
+  if(perft_depth > 0){
+    if(argv[optind] != NULL && access(argv[optind], F_OK) == 0){
+      board = file_parser(argv[optind]);
+    } else {
+      board = board_init(board_size);
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t nodes = board_perft(board, perft_depth);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) +
+      (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("perft(%ld) = %lu leaves in %.3f s (%.2f Mleaves/s)\n",
+      perft_depth, (unsigned long) nodes, seconds,
+      nodes / (seconds * 1e6));
+  } else if(playout_count > 0){
+    if(argv[optind] != NULL && access(argv[optind], F_OK) == 0){
+      board = file_parser(argv[optind]);
+    } else {
+      board = board_init(board_size);
+    }
+    size_t wins[3] = { 0 };
+    double margin = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0; i < playout_count; i++){
+      score_t score = board_random_playout(board);
+      wins[score.black > score.white ? 0 :
+        (score.black < score.white ? 1 : 2)]++;
+      margin += (double) score.black - (double) score.white;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) +
+      (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%zu playouts in %.3f s (%.0f playouts/s)\n", playout_count,
+      seconds, playout_count / seconds);
+    printf("black %zu, white %zu, draws %zu, mean margin %+.2f\n", wins[0],
+      wins[1], wins[2], margin / playout_count);
+  } else if(contest_mode){
     if(argv[optind] != NULL && access(argv[optind], F_OK) == 0){
       board = file_parser(argv[optind]);
       size_t depth = 5;
       size_t how_mayn_turns_left = turns_left(board);
-      if(how_mayn_turns_left < 10){
+      if(how_mayn_turns_left <= get_endgame_empties()){
         depth = how_mayn_turns_left;
       }
-      move_t move = minmax_ab_player(board, depth);
-      printf("%c%ld\n",(char) move.column + 'a',move.row + 1);
+      int value;
+      move_t solved;
+      if(solver_lookup(board, &value, &solved)){
+        printf("%c%ld\n", (char) solved.column + 'a', solved.row + 1);
+      } else if(deadline > 0){
+        contest_deadline(board, deadline);
+      } else if(analysis){
+        /* every move with its score, the best first */
+        search_result_t result = analyze(board);
+        for(size_t i = 0; i < result.scored; i++){
+          char text[16];
+          format_score(&result, result.scores[i].score, text, sizeof(text));
+          printf("%c%ld %s\n", (char) result.scores[i].move.column + 'a',
+            result.scores[i].move.row + 1, text);
+        }
+      } else {
+        move_t move = minmax_ab_player(board, depth);
+        printf("%c%ld\n",(char) move.column + 'a',move.row + 1);
+      }
     } else {
       void err();
       err(EXIT_FAILURE, "File unreadable");
@@ -327,5 +1086,9 @@ int main(int argc, char * const argv[]){
       (*tactics[white_tactic]), board);
   }
   board_free(board);
+  search_close_table();
+  if(recorder != NULL && !games_writer_close(recorder)){
+    return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,52 @@
+#include "rng.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/* State of the generator, one per thread */
+static _Thread_local uint64_t state[4];
+static _Thread_local bool rng_is_initialized = false;
+
+/* from https://prng.di.unimi.it/splitmix64.c, used to expand the seed */
+static uint64_t splitmix64(uint64_t *x){
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static uint64_t rotl(const uint64_t x, int k){
+  return (x << k) | (x >> (64 - k));
+}
+
+void rng_seed(uint64_t seed){
+  for(int i = 0; i < 4; i++){
+    state[i] = splitmix64(&seed);
+  }
+  rng_is_initialized = true;
+}
+
+/* from https://prng.di.unimi.it/xoshiro256starstar.c */
+uint64_t rng_next(void){
+  if(!rng_is_initialized){
+    /* the address of the state differs between threads started
+     * in the same second */
+    rng_seed((uint64_t) time(NULL) ^ (uint64_t) (uintptr_t) state);
+  }
+  const uint64_t result = rotl(state[1] * 5, 7) * 9;
+  const uint64_t t = state[1] << 17;
+  state[2] ^= state[0];
+  state[3] ^= state[1];
+  state[1] ^= state[2];
+  state[0] ^= state[3];
+  state[2] ^= t;
+  state[3] = rotl(state[3], 45);
+  return result;
+}
+
+/* Lemire's multiply-shift reduction, the bias is below 2^-58 for the
+ * small bounds used by the game */
+uint64_t rng_bounded(uint64_t bound){
+  return (uint64_t) (((unsigned __int128) rng_next() * bound) >> 64);
+}
@@ -0,0 +1,1907 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "search.h"
+
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <board.h>
+#include <player.h>
+#include <pool.h>
+
+/* ProbCut is tried on nodes of at least PROBCUT_MIN_DEPTH, deeper nodes
+ * use the parameters of PROBCUT_MAX_DEPTH */
+#define PROBCUT_MIN_DEPTH 3
+#define PROBCUT_MAX_DEPTH 16
+#define PROBCUT_STAGES 4
+/* pairs of searches needed to fit the parameters of a stage and depth */
+#define PROBCUT_MIN_SAMPLES 32
+
+/* Linear model of the value of a deep search from the value of a shallow
+ * one: deep = a * shallow + b, with an error of standard deviation sigma */
+typedef struct
+{
+  double a;
+  double b;
+  double sigma;
+} probcut_t;
+
+/* parameter tables, one per board size: size n uses table n / 2 - 1 */
+#define PROBCUT_SIZES (MAX_BOARD_SIZE / 2)
+
+/* Regression parameters of every board size, stage and depth, a zero
+ * sigma means not fitted, the next lower fitted depth is used then. A size
+ * without any fitted depth is searched without ProbCut. The defaults are
+ * fitted on positions of 8x8 self play games of the ai, the only size
+ * with defaults */
+static probcut_t
+  probcut[PROBCUT_SIZES][PROBCUT_STAGES][PROBCUT_MAX_DEPTH + 1] = {
+  [8 / 2 - 1] = {
+    [EARLY_GAME] = {
+      [3] = { 0.8104, 6.512, 34.038 },
+      [4] = { 0.9253, -8.489, 26.726 },
+      [5] = { 0.7287, 17.217, 39.809 },
+      [6] = { 0.8167, -12.767, 35.031 },
+      [7] = { 0.8582, 17.400, 32.716 },
+      [8] = { 0.8799, -6.031, 30.231 }
+    },
+    [MID_GAME] = {
+      [3] = { 0.9748, -8.555, 54.088 },
+      [4] = { 0.9934, -9.475, 47.450 },
+      [5] = { 0.9196, 2.115, 71.584 },
+      [6] = { 0.9121, -8.070, 68.177 },
+      [7] = { 0.8819, 15.934, 66.017 },
+      [8] = { 0.8528, -1.325, 66.148 }
+    },
+    [END_GAME] = {
+      [3] = { 1.0579, -7.801, 61.858 },
+      [4] = { 1.0458, -2.230, 57.263 },
+      [5] = { 1.0809, -6.789, 85.544 },
+      [6] = { 1.0800, -0.664, 80.164 },
+      [7] = { 1.0796, 5.722, 80.098 },
+      [8] = { 1.0893, 8.714, 78.480 }
+    },
+    [END_END_GAME] = {
+      [3] = { 1.2367, -73.146, 121.054 }
+    }
+  }
+};
+
+/* width of the cut of every selectivity level, in standard deviations */
+static const double probcut_thresholds[SEARCH_MAX_SELECTIVITY + 1] = {
+  0, 3.3, 2.6, 2.0, 1.5, 1.1
+};
+
+static int selectivity = 0;
+
+/* first aspiration window around the score of the previous iteration, it
+ * doubles on every re-search */
+#define SEARCH_ASPIRATION_WINDOW 40
+
+/* Late move reductions apply to the moves after the first LMR_MIN_MOVE of
+ * nodes of at least LMR_MIN_DEPTH, while more than LMR_MIN_EMPTIES
+ * squares are empty: the endgame is searched to full depth */
+#define LMR_MIN_DEPTH 3
+#define LMR_MIN_MOVE 4
+#define LMR_MIN_EMPTIES 14
+
+/* Time management: the clock time left, minus TIME_ENDGAME_RESERVE of it
+ * kept for the exact endgame (the last TIME_ENDGAME_EMPTIES squares), is
+ * shared by the moves to go. Midgame moves get more than opening moves.
+ * A search may use TIME_MAXIMUM_FACTOR times its target when the best
+ * move keeps changing, but never more than TIME_MAXIMUM_SHARE of the
+ * clock */
+#define TIME_ENDGAME_EMPTIES 14
+#define TIME_ENDGAME_RESERVE 0.25
+#define TIME_OPENING_FACTOR 0.7
+#define TIME_MIDGAME_FACTOR 1.4
+#define TIME_MAXIMUM_FACTOR 4.0
+#define TIME_MAXIMUM_SHARE 0.5
+/* the target grows by TIME_EXTENSION when the best move changes */
+#define TIME_EXTENSION 1.5
+/* a best move unchanged for TIME_STABLE_ITERATIONS dominates, the search
+ * stops after a quarter of its target then */
+#define TIME_STABLE_ITERATIONS 4
+/* an iteration is expected to take at least TIME_MIN_GROWTH times longer
+ * than the previous one */
+#define TIME_MIN_GROWTH 2.0
+/* seconds kept for the overhead of every move */
+#define TIME_SAFETY 0.02
+/* seconds a search may always take, so that an empty clock does not turn
+ * into a search without limit */
+#define TIME_MINIMUM 0.001
+/* nodes between two looks at the clock */
+#define TIME_CHECK_NODES 1024
+
+/* Parallel exact iterations: nodes of at least SPLIT_MIN_DEPTH share the
+ * younger brothers of their eldest move with the other threads */
+#define SPLIT_MIN_DEPTH 7
+
+/* entries of the transposition table of a search, and of a table file,
+ * powers of two */
+#define TT_SIZE (1 << 18)
+#define TT_FILE_SIZE (1 << 20)
+/* move of an entry that failed low and has no best move */
+#define TT_NO_MOVE USHRT_MAX
+
+/* entries of the evaluation cache, a power of two */
+#define EVAL_CACHE_SIZE (1 << 16)
+/* flag of the data of an evaluation cache entry, so that a zero entry is
+ * never taken for the value 0 */
+#define EVAL_VALID ((uint64_t) 1 << 32)
+
+/* first bytes of a table file, followed by the number of entries */
+#define TT_MAGIC "RVHASH01"
+/* bytes of the header of a table file, the entries follow */
+#define TT_HEADER 64
+
+/* Kind of bound that the value of a transposition table entry is */
+typedef enum {
+  TT_EXACT,
+  TT_LOWER,
+  TT_UPPER
+} tt_bound_t;
+
+/* A searched position, packed into data as the value (bits 0-31), the
+ * depth (32-39), the bound (40-47) and the square of the best move
+ * (48-63), tried first when the position comes again. check is the key
+ * xor data: the words are written without lock by every thread and
+ * process, and an entry whose words come from two writes, or from another
+ * position sharing the slot, fails the check and is ignored. The newest
+ * search of a slot replaces the former one */
+typedef struct
+{
+  _Atomic uint64_t check;
+  _Atomic uint64_t data;
+} tt_entry_t;
+
+/* table mapped from a file by search_open_table, NULL if none */
+static tt_entry_t *shared_table = NULL;
+static size_t shared_size = 0;
+
+/* Transposition table of the searches of a thread, allocated by its first
+ * search and kept for the next ones, freed when the thread exits. Every
+ * search mixes a new generation into its salt: the entries of the former
+ * searches never match and are overwritten as if the table was cleared,
+ * without clearing it */
+static _Thread_local tt_entry_t *thread_table = NULL;
+static _Thread_local uint64_t thread_generation = 0;
+static pthread_key_t thread_table_key;
+static pthread_once_t thread_table_once = PTHREAD_ONCE_INIT;
+
+/* Evaluation cache: the heuristic values of the nodes evaluated last, by
+ * every search and thread of the process, so that the leaves met again
+ * through transpositions and re-searches are not evaluated again. Its
+ * entries hold the value (bits 0-31) and EVAL_VALID as data, and are
+ * written and checked without lock like those of the transposition
+ * table */
+static tt_entry_t eval_cache[EVAL_CACHE_SIZE];
+
+/* Ply of the search stack: the node searched at that ply and its moves in
+ * search order. Plies are cache line aligned, a node never shares a line
+ * with its neighbours. squares is sized for the largest board (640 bytes
+ * a ply) but only its first count entries are touched, so its tail costs
+ * stack space and no cache lines: bounding it by 64 moves made no
+ * difference to the 8x8 bench beyond the noise */
+typedef struct
+{
+  _Alignas(64) board_node_t node;
+  size_t count;
+  unsigned short squares[SEARCH_MAX_MOVES];
+} search_ply_t;
+
+typedef struct split_t split_t;
+typedef struct parallel_t parallel_t;
+
+/* State of one search, used by one thread */
+typedef struct
+{
+  int selectivity;
+  bool reductions;
+  /* transposition table of table_size entries, NULL searches without one */
+  tt_entry_t *table;
+  size_t table_size;
+  /* mixed into the keys, so that searches evaluating or pruning
+   * differently do not share entries */
+  uint64_t salt;
+  struct timespec start;
+  /* seconds after which the search is interrupted, 0 for no limit */
+  double limit;
+  /* nodes after which the search is interrupted, 0 for no limit */
+  uint64_t max_nodes;
+  /* set by another thread to interrupt the search, NULL if none */
+  atomic_bool *stop;
+  bool timeout;
+  uint64_t nodes;
+  /* mixed into the keys of the evaluation cache, from the weights */
+  uint64_t eval_salt;
+  /* heuristic values asked for, and those found in the evaluation cache */
+  uint64_t evaluations;
+  uint64_t eval_hits;
+  size_t size;
+  const board_context_t *context;
+  /* preallocated stack of the nodes of the current line, the root at 0,
+   * so that the recursion copies and allocates nothing */
+  search_ply_t *stack;
+  /* threads sharing the nodes of the search, NULL if it runs alone */
+  parallel_t *parallel;
+  /* innermost split point whose moves the thread searches, NULL if none,
+   * the search stops when it or one around it is cut off */
+  const split_t *split;
+  /* move tried first at the root, the best of the previous iteration */
+  move_t hint;
+  /* triangular principal variation table, row ply holds the best line
+   * found from ply on, as square indexes */
+  size_t pv_length[SEARCH_MAX_PLY + 1];
+  unsigned short pv[SEARCH_MAX_PLY][SEARCH_MAX_PLY];
+} search_t;
+
+static FILE *search_output = NULL;
+
+static search_t *search_new(int selectivity, bool reductions){
+  search_t *search = malloc(sizeof(search_t));
+  if(search == NULL){
+    return NULL;
+  }
+  search->stack = aligned_alloc(_Alignof(search_ply_t),
+    (SEARCH_MAX_PLY + 1) * sizeof(search_ply_t));
+  if(search->stack == NULL){
+    free(search);
+    return NULL;
+  }
+  search->selectivity = selectivity;
+  search->reductions = reductions;
+  search->table = NULL;
+  search->table_size = 0;
+  search->salt = 0;
+  clock_gettime(CLOCK_MONOTONIC, &search->start);
+  search->limit = 0;
+  search->max_nodes = 0;
+  search->stop = NULL;
+  search->timeout = false;
+  search->nodes = 0;
+  search->eval_salt = 0;
+  search->evaluations = 0;
+  search->eval_hits = 0;
+  search->size = 0;
+  search->context = NULL;
+  search->parallel = NULL;
+  search->split = NULL;
+  search->hint = (move_t) { MAX_BOARD_SIZE + 1, MAX_BOARD_SIZE + 1};
+  search->pv_length[0] = 0;
+  return search;
+}
+
+static void search_free(search_t *search){
+  if(search != NULL){
+    free(search->stack);
+    free(search);
+  }
+}
+
+/* FNV-1a hash of length bytes, continuing hash */
+static uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t length){
+  const unsigned char *p = bytes;
+  for(size_t i = 0; i < length; i++){
+    hash = (hash ^ p[i]) * 0x100000001b3;
+  }
+  return hash;
+}
+
+static void thread_table_key_create(void){
+  pthread_key_create(&thread_table_key, free);
+}
+
+/* returns the table of the calling thread and sets generation to the
+ * generation of the new search, NULL if it cannot be allocated */
+static tt_entry_t *thread_table_get(uint64_t *generation){
+  if(thread_table == NULL){
+    pthread_once(&thread_table_once, thread_table_key_create);
+    thread_table = calloc(TT_SIZE, sizeof(tt_entry_t));
+    if(thread_table == NULL){
+      return NULL;
+    }
+    pthread_setspecific(thread_table_key, thread_table);
+  }
+  *generation = ++thread_generation;
+  return thread_table;
+}
+
+/* salt of the evaluation cache keys, from the evaluation weights */
+static uint64_t eval_salt(void){
+  uint64_t salt = 0xcbf29ce484222325;
+  for(int stage = EARLY_GAME; stage <= END_END_GAME; stage++){
+    heuristic_weights_t weights = get_weights(stage);
+    salt = hash_bytes(salt, &weights, sizeof(heuristic_weights_t));
+  }
+  return salt;
+}
+
+/* makes board the root of the following searches */
+static void search_set_root(search_t *search, const board_t *board){
+  search->size = board_size(board);
+  search->context = board_get_context(board);
+  search->eval_salt = eval_salt();
+  board_node_init(&search->stack[0].node, board);
+}
+
+void set_search_output(FILE *fd){
+  search_output = fd;
+}
+
+int get_selectivity(void){
+  return selectivity;
+}
+
+void set_selectivity(int level){
+  if(level >= 0 && level <= SEARCH_MAX_SELECTIVITY){
+    selectivity = level;
+  }
+}
+
+/* value of a finished game for the player to move */
+static int end_value(const search_t *search, const board_node_t *node){
+  const int difference = board_node_score(search->context, node);
+  if(difference > 0){
+    return SEARCH_WIN + difference;
+  } else if(difference < 0){
+    return -SEARCH_WIN + difference;
+  }
+  return 0;
+}
+
+/* depth of the shallow search predicting a search of depth, about half of
+ * it and of the same parity, as the evaluation is biased towards the
+ * player who moved last */
+static size_t probcut_shallow(size_t depth){
+  size_t shallow = depth / 2;
+  if((depth - shallow) % 2 != 0){
+    shallow--;
+  }
+  return shallow;
+}
+
+/* parameter table of the board size */
+static size_t probcut_table(size_t size){
+  return (size / 2) - 1;
+}
+
+static const probcut_t *probcut_parameters(size_t size, game_stage stage,
+  size_t depth){
+  const probcut_t *parameters = probcut[probcut_table(size)][stage];
+  if(depth > PROBCUT_MAX_DEPTH){
+    depth = PROBCUT_MAX_DEPTH;
+  }
+  while(depth >= PROBCUT_MIN_DEPTH && parameters[depth].sigma == 0){
+    depth--;
+  }
+  if(depth < PROBCUT_MIN_DEPTH){
+    return NULL;
+  }
+  return &parameters[depth];
+}
+
+static double elapsed(const struct timespec *start){
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Node whose younger brothers are searched by several threads, the owner
+ * and the helpers started by the pool while moves are left. It is freed
+ * by the last thread releasing it, a helper may start after its owner is
+ * done */
+struct split_t
+{
+  pthread_mutex_t lock;
+  /* signalled when the last active helper is done */
+  pthread_cond_t idle;
+  parallel_t *parallel;
+  const split_t *parent;
+  search_t *owner;
+  board_node_t node;
+  size_t ply;
+  size_t depth;
+  int beta;
+  bool reduce;
+  size_t count;
+  unsigned short squares[SEARCH_MAX_MOVES];
+  /* a move reached beta, the threads still searching stop */
+  atomic_bool cut;
+  /* guarded by lock: the window and best move so far, the next move to
+   * search, the helpers searching and the threads holding the split */
+  int alpha;
+  int best;
+  size_t best_index;
+  size_t next;
+  size_t active;
+  size_t references;
+  bool closed;
+};
+
+/* Threads of a parallel search: the workers of the pool help the calling
+ * thread, each with a search of its own taken from a free list */
+struct parallel_t
+{
+  pool_t *pool;
+  pthread_mutex_t lock;
+  search_t **searches;
+  size_t free;
+  /* nodes and evaluations of the helpers */
+  atomic_uint_least64_t nodes;
+  atomic_uint_least64_t evaluations;
+  atomic_uint_least64_t eval_hits;
+};
+
+/* returns true if the split point or one around it is cut off */
+static bool split_cut(const split_t *split){
+  for(; split != NULL; split = split->parent){
+    if(atomic_load_explicit(&split->cut, memory_order_relaxed)){
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool search_timeout(search_t *search){
+  if(search->split != NULL && split_cut(search->split)){
+    search->timeout = true;
+  }
+  if(search->stop != NULL &&
+    atomic_load_explicit(search->stop, memory_order_relaxed)){
+    search->timeout = true;
+  }
+  if(search->max_nodes > 0 && search->nodes >= search->max_nodes){
+    search->timeout = true;
+  }
+  if(search->limit > 0 && search->nodes % TIME_CHECK_NODES == 0 &&
+    elapsed(&search->start) >= search->limit){
+    search->timeout = true;
+  }
+  return search->timeout;
+}
+
+/* makes row ply of the principal variation move followed by row ply + 1 */
+static void pv_update(search_t *search, size_t ply, size_t square){
+  const size_t length = search->pv_length[ply + 1];
+  search->pv[ply][0] = square;
+  memcpy(&search->pv[ply][1], search->pv[ply + 1],
+    length * sizeof(unsigned short));
+  search->pv_length[ply] = length + 1;
+}
+
+/* moves square to the front of the moves of a ply, the others keep their
+ * order */
+static void move_first(search_ply_t *ply, size_t square){
+  for(size_t i = 1; i < ply->count; i++){
+    if(ply->squares[i] == square){
+      memmove(&ply->squares[1], &ply->squares[0],
+        i * sizeof(unsigned short));
+      ply->squares[0] = square;
+      return;
+    }
+  }
+}
+
+/* looks node up in the evaluation cache, returns true and its value in
+ * value if it is there. key is set to its key either way */
+static bool eval_probe(search_t *search, const board_node_t *node,
+  uint64_t *key, int *value){
+  *key = board_node_hash(search->context, node) ^ search->eval_salt;
+  const tt_entry_t *entry = &eval_cache[*key & (EVAL_CACHE_SIZE - 1)];
+  const uint64_t data = atomic_load_explicit(&entry->data,
+    memory_order_relaxed);
+  const uint64_t check = atomic_load_explicit(&entry->check,
+    memory_order_relaxed);
+  search->evaluations++;
+  if((check ^ data) == *key && (data & EVAL_VALID) != 0){
+    search->eval_hits++;
+    *value = (int32_t) (uint32_t) data;
+    return true;
+  }
+  return false;
+}
+
+static void eval_store(uint64_t key, int value){
+  tt_entry_t *entry = &eval_cache[key & (EVAL_CACHE_SIZE - 1)];
+  const uint64_t data = (uint64_t) (uint32_t) value | EVAL_VALID;
+  atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+  atomic_store_explicit(&entry->check, key ^ data, memory_order_relaxed);
+}
+
+/* returns final_heuristic_node of node, from the evaluation cache if it
+ * holds the node */
+static int search_evaluate(search_t *search, const board_node_t *node){
+  uint64_t key;
+  int value;
+  if(!eval_probe(search, node, &key, &value)){
+    value = final_heuristic_node(search->context, node);
+    eval_store(key, value);
+  }
+  return value;
+}
+
+/* search_evaluate of count nodes, those missing from the evaluation cache
+ * are evaluated in one batch */
+static void search_evaluate_batch(search_t *search,
+  const board_node_t nodes[], size_t count, int values[]){
+  board_node_t missing[SEARCH_MAX_MOVES];
+  uint64_t keys[SEARCH_MAX_MOVES];
+  size_t indexes[SEARCH_MAX_MOVES];
+  int missing_values[SEARCH_MAX_MOVES];
+  size_t misses = 0;
+  for(size_t i = 0; i < count; i++){
+    if(!eval_probe(search, &nodes[i], &keys[misses], &values[i])){
+      missing[misses] = nodes[i];
+      indexes[misses++] = i;
+    }
+  }
+  if(misses == 0){
+    return;
+  }
+  final_heuristic_node_batch(search->context, missing, misses,
+    missing_values);
+  for(size_t i = 0; i < misses; i++){
+    values[indexes[i]] = missing_values[i];
+    eval_store(keys[i], missing_values[i]);
+  }
+}
+
+/* lists the moves of the node of a ply, best first according to the
+ * heuristic value of their child when ordered is set */
+static void search_children(search_t *search, search_ply_t *ply,
+  bool ordered){
+  unsigned short squares[SEARCH_MAX_MOVES];
+  int values[SEARCH_MAX_MOVES];
+  const size_t count = board_node_moves(search->context, &ply->node,
+    squares);
+  if(ordered){
+    board_node_t children[SEARCH_MAX_MOVES];
+    bool passed[SEARCH_MAX_MOVES];
+    for(size_t i = 0; i < count; i++){
+      passed[i] = board_node_play(search->context, &ply->node, squares[i],
+        &children[i]);
+    }
+    search_evaluate_batch(search, children, count, values);
+    for(size_t i = 0; i < count; i++){
+      if(!passed[i]){
+        values[i] = -values[i];
+      }
+    }
+  } else {
+    memset(values, 0, count * sizeof(int));
+  }
+  /* insertion sort, stable so that equal moves keep the board order */
+  for(size_t i = 0; i < count; i++){
+    const int value = values[i];
+    size_t j = i;
+    while(j > 0 && values[j - 1] < value){
+      ply->squares[j] = ply->squares[j - 1];
+      values[j] = values[j - 1];
+      j--;
+    }
+    ply->squares[j] = squares[i];
+    values[j] = value;
+  }
+  ply->count = count;
+}
+
+/* reads the entry of key into value, depth, bound and move, returns false
+ * if the slot holds another position or a torn entry */
+static bool tt_probe(const search_t *search, uint64_t key, int *value,
+  size_t *depth, tt_bound_t *bound, size_t *move){
+  const tt_entry_t *entry = &search->table[key & (search->table_size - 1)];
+  const uint64_t data = atomic_load_explicit(&entry->data,
+    memory_order_relaxed);
+  const uint64_t check = atomic_load_explicit(&entry->check,
+    memory_order_relaxed);
+  if((check ^ data) != key || ((data >> 40) & 0xff) > TT_UPPER){
+    return false;
+  }
+  *value = (int32_t) (uint32_t) data;
+  *depth = (data >> 32) & 0xff;
+  *bound = (data >> 40) & 0xff;
+  *move = data >> 48;
+  return true;
+}
+
+static void tt_store(search_t *search, uint64_t key, int value, size_t depth,
+  tt_bound_t bound, size_t move){
+  tt_entry_t *entry = &search->table[key & (search->table_size - 1)];
+  const uint64_t data = (uint64_t) (uint32_t) value | (uint64_t) depth << 32 |
+    (uint64_t) bound << 40 | (uint64_t) move << 48;
+  atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+  atomic_store_explicit(&entry->check, key ^ data, memory_order_relaxed);
+}
+
+static int alphabeta(search_t *search, size_t ply, size_t depth, int alpha,
+  int beta);
+
+/* plays square of the node of ply into the next ply and returns the value
+ * of the child for the player of ply, who moves again if the opponent has
+ * to pass */
+static int child_value(search_t *search, size_t ply, size_t square,
+  size_t depth, int alpha, int beta){
+  if(board_node_play(search->context, &search->stack[ply].node, square,
+    &search->stack[ply + 1].node)){
+    return alphabeta(search, ply + 1, depth, alpha, beta);
+  }
+  return -alphabeta(search, ply + 1, depth, -beta, -alpha);
+}
+
+/* Multi-ProbCut: a shallow search whose prediction lies beyond the window
+ * by the threshold of the selectivity cuts the node, returns true and its
+ * bound in value then. The shallow search is only tried on the side of the
+ * window where the static evaluation already is */
+static bool probcut_cut(search_t *search, size_t ply, size_t depth,
+  int alpha, int beta, int *value){
+  const board_node_t *node = &search->stack[ply].node;
+  if(search->selectivity == 0 || depth < PROBCUT_MIN_DEPTH ||
+    depth >= board_node_empties(search->context, node)){
+    return false;
+  }
+  if(alpha <= -SEARCH_WIN || beta >= SEARCH_WIN){
+    return false;
+  }
+  const probcut_t *p = probcut_parameters(search->size,
+    board_node_stage(search->context, node), depth);
+  if(p == NULL){
+    return false;
+  }
+  const size_t shallow = probcut_shallow(depth);
+  const double margin = probcut_thresholds[search->selectivity] * p->sigma;
+  const int eval = search_evaluate(search, node);
+  int bound = (int) ceil((beta + margin - p->b) / p->a);
+  if(bound < SEARCH_WIN && eval >= beta &&
+    alphabeta(search, ply, shallow, bound - 1, bound) >= bound){
+    *value = beta;
+    return true;
+  }
+  bound = (int) floor((alpha - margin - p->b) / p->a);
+  if(bound > -SEARCH_WIN && eval <= alpha &&
+    alphabeta(search, ply, shallow, bound, bound + 1) <= bound){
+    *value = alpha;
+    return true;
+  }
+  return false;
+}
+
+/* depth reduction of the index-th move of the node of ply, growing with
+ * both */
+static size_t lmr_reduction(const search_t *search, size_t ply,
+  size_t depth, size_t index){
+  if(!search->reductions || depth < LMR_MIN_DEPTH || index < LMR_MIN_MOVE ||
+    board_node_empties(search->context, &search->stack[ply].node) <=
+    LMR_MIN_EMPTIES){
+    return 0;
+  }
+  size_t reduction = (size_t) (0.5 + (log(depth) * log(index) / 3));
+  if(reduction > depth - 2){
+    reduction = depth - 2;
+  }
+  return reduction;
+}
+
+static int split_moves(search_t *search, size_t ply, size_t depth,
+  int alpha, int beta, bool reduce, int best, size_t *best_index);
+
+/* searches the moves of the ply in order: the first with the window
+ * alpha, beta, the next ones with a null window to prove that they are not
+ * better, possibly at a reduced depth, and again if they are. Returns the
+ * best value, best_index is the index of the move raising alpha last or
+ * the number of moves if none did */
+
+static int search_moves(search_t *search, size_t ply, size_t depth,
+  int alpha, int beta, bool reduce, size_t *best_index){
+  const search_ply_t *moves = &search->stack[ply];
+  int best = -MAX_INT;
+  *best_index = moves->count;
+  for(size_t i = 0; i < moves->count; i++){
+    /* once the eldest move is searched, the others may be shared */
+    if(i == 1 && search->parallel != NULL && depth >= SPLIT_MIN_DEPTH &&
+      moves->count > 2 && !search->timeout){
+      return split_moves(search, ply, depth, alpha, beta, reduce, best,
+        best_index);
+    }
+    const size_t square = moves->squares[i];
+    int value;
+    if(i == 0){
+      value = child_value(search, ply, square, depth - 1, alpha, beta);
+    } else {
+      size_t reduction = reduce ? lmr_reduction(search, ply, depth, i) : 0;
+      value = child_value(search, ply, square, depth - 1 - reduction, alpha,
+        alpha + 1);
+      if(value > alpha && reduction > 0){
+        value = child_value(search, ply, square, depth - 1, alpha,
+          alpha + 1);
+      }
+      if(value > alpha && value < beta){
+        value = child_value(search, ply, square, depth - 1, alpha, beta);
+      }
+    }
+    if(value > best){
+      best = value;
+      if(best > alpha){
+        alpha = best;
+        *best_index = i;
+        pv_update(search, ply, square);
+        if(alpha >= beta){
+          break;
+        }
+      }
+    }
+  }
+  return best;
+}
+
+/* drops a reference to the split point, the last one frees it */
+static void split_release(split_t *split){
+  pthread_mutex_lock(&split->lock);
+  const bool last = --split->references == 0;
+  pthread_mutex_unlock(&split->lock);
+  if(last){
+    pthread_mutex_destroy(&split->lock);
+    pthread_cond_destroy(&split->idle);
+    free(split);
+  }
+}
+
+/* searches the moves of the split point left, one at a time, until none is
+ * left or one reaches beta. The search of the thread has the node of the
+ * split point at its ply */
+static void split_search(search_t *search, split_t *split){
+  const size_t ply = split->ply;
+  const size_t depth = split->depth;
+  const int beta = split->beta;
+  while(true){
+    pthread_mutex_lock(&split->lock);
+    if(split->next >= split->count || split->alpha >= beta){
+      pthread_mutex_unlock(&split->lock);
+      return;
+    }
+    const size_t i = split->next++;
+    const int alpha = split->alpha;
+    pthread_mutex_unlock(&split->lock);
+    const size_t square = split->squares[i];
+    size_t reduction = split->reduce ? lmr_reduction(search, ply, depth, i) :
+      0;
+    int value = child_value(search, ply, square, depth - 1 - reduction,
+      alpha, alpha + 1);
+    if(value > alpha && reduction > 0){
+      value = child_value(search, ply, square, depth - 1, alpha, alpha + 1);
+    }
+    if(value > alpha && value < beta){
+      value = child_value(search, ply, square, depth - 1, alpha, beta);
+    }
+    if(search->timeout){
+      return;
+    }
+    pthread_mutex_lock(&split->lock);
+    if(value > split->best){
+      split->best = value;
+      if(value > split->alpha){
+        search_t *owner = split->owner;
+        const size_t length = search->pv_length[ply + 1];
+        split->alpha = value;
+        split->best_index = i;
+        owner->pv[ply][0] = square;
+        memcpy(&owner->pv[ply][1], search->pv[ply + 1],
+          length * sizeof(unsigned short));
+        owner->pv_length[ply] = length + 1;
+        if(value >= beta){
+          atomic_store_explicit(&split->cut, true, memory_order_relaxed);
+        }
+      }
+    }
+    pthread_mutex_unlock(&split->lock);
+  }
+}
+
+/* task of a pool worker joining a split point */
+static void split_help(void *argument){
+  split_t *split = argument;
+  parallel_t *parallel = split->parallel;
+  pthread_mutex_lock(&split->lock);
+  const bool useful = !split->closed && split->next < split->count &&
+    split->alpha < split->beta;
+  if(useful){
+    split->active++;
+  }
+  pthread_mutex_unlock(&split->lock);
+  if(useful){
+    pthread_mutex_lock(&parallel->lock);
+    search_t *search = parallel->searches[--parallel->free];
+    pthread_mutex_unlock(&parallel->lock);
+    const search_t *owner = split->owner;
+    search->selectivity = owner->selectivity;
+    search->reductions = owner->reductions;
+    search->table = owner->table;
+    search->table_size = owner->table_size;
+    search->salt = owner->salt;
+    search->start = owner->start;
+    search->limit = owner->limit;
+    search->max_nodes = owner->max_nodes;
+    search->stop = owner->stop;
+    search->size = owner->size;
+    search->context = owner->context;
+    search->parallel = parallel;
+    search->split = split;
+    search->eval_salt = owner->eval_salt;
+    search->timeout = false;
+    search->nodes = 0;
+    search->evaluations = 0;
+    search->eval_hits = 0;
+    search->stack[split->ply].node = split->node;
+    split_search(search, split);
+    atomic_fetch_add(&parallel->nodes, search->nodes);
+    atomic_fetch_add(&parallel->evaluations, search->evaluations);
+    atomic_fetch_add(&parallel->eval_hits, search->eval_hits);
+    pthread_mutex_lock(&parallel->lock);
+    parallel->searches[parallel->free++] = search;
+    pthread_mutex_unlock(&parallel->lock);
+    pthread_mutex_lock(&split->lock);
+    if(--split->active == 0){
+      pthread_cond_signal(&split->idle);
+    }
+    pthread_mutex_unlock(&split->lock);
+  }
+  split_release(split);
+}
+
+/* Young brothers wait: the eldest move of the node of ply was searched and
+ * gave best without cut off, the others are shared with the workers of the
+ * pool, which join the split point while moves are left. Returns as
+ * search_moves once every thread is done with the split point */
+static int split_moves(search_t *search, size_t ply, size_t depth,
+  int alpha, int beta, bool reduce, int best, size_t *best_index){
+  const search_ply_t *moves = &search->stack[ply];
+  parallel_t *parallel = search->parallel;
+  split_t *split = malloc(sizeof(split_t));
+  if(split == NULL){
+    /* searched alone as if there were no other thread */
+    search->parallel = NULL;
+    const int value = search_moves(search, ply, depth, alpha, beta, reduce,
+      best_index);
+    search->parallel = parallel;
+    return value;
+  }
+  pthread_mutex_init(&split->lock, NULL);
+  pthread_cond_init(&split->idle, NULL);
+  split->parallel = parallel;
+  split->parent = search->split;
+  split->owner = search;
+  split->node = moves->node;
+  split->ply = ply;
+  split->depth = depth;
+  split->beta = beta;
+  split->reduce = reduce;
+  split->count = moves->count;
+  memcpy(split->squares, moves->squares,
+    moves->count * sizeof(unsigned short));
+  atomic_init(&split->cut, false);
+  split->alpha = best > alpha ? best : alpha;
+  split->best = best;
+  split->best_index = *best_index;
+  split->next = 1;
+  split->active = 0;
+  split->closed = false;
+  size_t helpers = pool_threads(parallel->pool);
+  if(helpers > moves->count - 2){
+    helpers = moves->count - 2;
+  }
+  /* the helpers may start and release the split point at once */
+  split->references = 1 + helpers;
+  for(size_t i = 0; i < helpers; i++){
+    if(!pool_submit(parallel->pool, split_help, split)){
+      pthread_mutex_lock(&split->lock);
+      split->references -= helpers - i;
+      pthread_mutex_unlock(&split->lock);
+      break;
+    }
+  }
+  search->split = split;
+  split_search(search, split);
+  /* the helpers not started yet will find the split point closed */
+  pthread_mutex_lock(&split->lock);
+  split->closed = true;
+  while(split->active > 0){
+    pthread_cond_wait(&split->idle, &split->lock);
+  }
+  best = split->best;
+  *best_index = split->best_index;
+  pthread_mutex_unlock(&split->lock);
+  search->split = split->parent;
+  /* a cut off of this split point only stopped its own moves */
+  search->timeout = split_cut(search->split) || (search->stop != NULL &&
+    atomic_load_explicit(search->stop, memory_order_relaxed)) ||
+    (search->max_nodes > 0 && search->nodes >= search->max_nodes) ||
+    (search->limit > 0 && elapsed(&search->start) >= search->limit);
+  split_release(split);
+  return best;
+}
+
+/* starts the threads of a parallel search, threads counting the calling
+ * one, NULL on failure */
+static parallel_t *parallel_new(size_t threads){
+  parallel_t *parallel = malloc(sizeof(parallel_t));
+  if(parallel == NULL){
+    return NULL;
+  }
+  parallel->pool = pool_new(threads - 1);
+  parallel->searches = calloc(threads - 1, sizeof(search_t *));
+  pthread_mutex_init(&parallel->lock, NULL);
+  atomic_init(&parallel->nodes, 0);
+  atomic_init(&parallel->evaluations, 0);
+  atomic_init(&parallel->eval_hits, 0);
+  parallel->free = 0;
+  bool ok = parallel->pool != NULL && parallel->searches != NULL;
+  while(ok && parallel->free < threads - 1){
+    search_t *search = search_new(0, false);
+    ok = search != NULL;
+    if(ok){
+      parallel->searches[parallel->free++] = search;
+    }
+  }
+  if(!ok){
+    if(parallel->pool != NULL){
+      pool_free(parallel->pool);
+    }
+    for(size_t i = 0; i < parallel->free; i++){
+      search_free(parallel->searches[i]);
+    }
+    free(parallel->searches);
+    pthread_mutex_destroy(&parallel->lock);
+    free(parallel);
+    return NULL;
+  }
+  return parallel;
+}
+
+static void parallel_free(parallel_t *parallel){
+  if(parallel == NULL){
+    return;
+  }
+  /* the helpers still queued find their split points closed */
+  pool_free(parallel->pool);
+  for(size_t i = 0; i < parallel->free; i++){
+    search_free(parallel->searches[i]);
+  }
+  free(parallel->searches);
+  pthread_mutex_destroy(&parallel->lock);
+  free(parallel);
+}
+
+/* negamax alpha-beta search of the node of ply, the value is seen from the
+ * player to move */
+static int alphabeta(search_t *search, size_t ply, size_t depth, int alpha,
+  int beta){
+  search_ply_t *current = &search->stack[ply];
+  search->nodes++;
+  search->pv_length[ply] = 0;
+  if(board_node_finished(search->context, &current->node)){
+    return end_value(search, &current->node);
+  }
+  if(depth == 0 || search_timeout(search)){
+    return search_evaluate(search, &current->node);
+  }
+  uint64_t key = 0;
+  size_t tt_move = TT_NO_MOVE;
+  int value;
+  if(search->table != NULL){
+    key = board_node_hash(search->context, &current->node) ^ search->salt;
+    size_t tt_depth;
+    tt_bound_t bound;
+    if(tt_probe(search, key, &value, &tt_depth, &bound, &tt_move) &&
+      beta - alpha == 1 && tt_depth >= depth &&
+      (bound == TT_EXACT || (bound == TT_LOWER && value >= beta) ||
+      (bound == TT_UPPER && value <= alpha))){
+      /* only null window nodes are cut, so that the principal variation
+       * stays whole */
+      return value;
+    }
+  }
+  if(probcut_cut(search, ply, depth, alpha, beta, &value)){
+    return value;
+  }
+  /* the shallow searches of ProbCut left their line in the row */
+  search->pv_length[ply] = 0;
+  search_children(search, current, depth > 1);
+  move_first(current, tt_move);
+  size_t best_index;
+  value = search_moves(search, ply, depth, alpha, beta, true, &best_index);
+  if(search->table != NULL && !search->timeout){
+    if(best_index < current->count){
+      tt_move = current->squares[best_index];
+    }
+    tt_store(search, key, value, depth, value <= alpha ? TT_UPPER :
+      (value >= beta ? TT_LOWER : TT_EXACT), tt_move);
+  }
+  return value;
+}
+
+/* searches the root with the window alpha, beta, trying the hint first.
+ * Returns the best value, the best line is in row 0 of the principal
+ * variation if it lies within the window */
+static int search_root(search_t *search, size_t depth, int alpha, int beta){
+  search_ply_t *root = &search->stack[0];
+  search_children(search, root, depth > 1);
+  move_first(root, search->hint.row * search->size + search->hint.column);
+  search->nodes++;
+  search->pv_length[0] = 0;
+  size_t best_index;
+  return search_moves(search, 0, depth, alpha, beta, false, &best_index);
+}
+
+/* Move of the root of an analysis */
+typedef struct
+{
+  size_t square;
+  move_t move;
+  /* scores of the last two completed iterations */
+  int score;
+  int previous;
+} root_move_t;
+
+/* searches the root, or only its move root if it is not NULL, with a
+ * window around guess that widens while the score falls out of it. Without
+ * a guess, or beyond a won game, the window is full from the start */
+static int search_window(search_t *search, const root_move_t *root,
+  size_t depth, int guess, bool guessed, size_t *researches){
+  int delta = SEARCH_ASPIRATION_WINDOW;
+  int alpha = -MAX_INT;
+  int beta = MAX_INT;
+  if(guessed && abs(guess) < SEARCH_WIN){
+    alpha = guess - delta;
+    beta = guess + delta;
+  }
+  while(true){
+    int score;
+    if(root == NULL){
+      score = search_root(search, depth, alpha, beta);
+    } else {
+      score = child_value(search, 0, root->square, depth - 1, alpha, beta);
+    }
+    if(search->timeout){
+      return score;
+    }
+    if(score <= alpha){
+      alpha = score - delta;
+    } else if(score >= beta){
+      beta = score + delta;
+    } else {
+      return score;
+    }
+    delta *= 2;
+    (*researches)++;
+    if(alpha <= -SEARCH_WIN){
+      alpha = -MAX_INT;
+    }
+    if(beta >= SEARCH_WIN){
+      beta = MAX_INT;
+    }
+  }
+}
+
+/* searches every move of the root with its own window around its score
+ * of the previous iteration of the same parity, as the evaluation favours
+ * the player who moved last, so that all the scores are exact values and
+ * not only bounds. The moves share the transposition table, whose best
+ * moves and cut nodes carry over from one move and iteration to the next.
+ * The best line is left in row 0 of the principal variation, and the
+ * scores are only updated if the iteration completes */
+static void search_all(search_t *search, root_move_t roots[], size_t count,
+  size_t depth, size_t *researches){
+  int values[SEARCH_MAX_MOVES];
+  int best = -MAX_INT;
+  search->nodes++;
+  search->pv_length[0] = 0;
+  for(size_t i = 0; i < count && !search->timeout; i++){
+    values[i] = search_window(search, &roots[i], depth,
+      depth > 2 ? roots[i].previous : roots[i].score, depth > 1, researches);
+    if(values[i] > best && !search->timeout){
+      best = values[i];
+      pv_update(search, 0, roots[i].square);
+    }
+  }
+  if(search->timeout){
+    return;
+  }
+  /* stable insertion sort, best first */
+  for(size_t i = 0; i < count; i++){
+    root_move_t root = roots[i];
+    root.previous = root.score;
+    root.score = values[i];
+    size_t j = i;
+    while(j > 0 && roots[j - 1].score < root.score){
+      roots[j] = roots[j - 1];
+      j--;
+    }
+    roots[j] = root;
+  }
+}
+
+/* copies the principal variation of the last root search into result */
+static void search_result_pv(const search_t *search,
+  search_result_t *result){
+  result->pv_length = search->pv_length[0];
+  for(size_t i = 0; i < result->pv_length; i++){
+    result->pv[i].row = search->pv[0][i] / search->size;
+    result->pv[i].column = search->pv[0][i] % search->size;
+  }
+  if(result->pv_length > 0){
+    result->move = result->pv[0];
+  }
+}
+
+/* full window search of the root to depth, without iterative deepening */
+static search_result_t search_fixed(search_t *search, board_t *board,
+  size_t depth){
+  search_result_t result;
+  result.move = (move_t) { MAX_BOARD_SIZE + 1, MAX_BOARD_SIZE + 1};
+  result.depth = depth;
+  result.researches = 0;
+  search->nodes = 0;
+  search->evaluations = 0;
+  search->eval_hits = 0;
+  search_set_root(search, board);
+  result.score = search_root(search, depth, -MAX_INT, MAX_INT);
+  result.nodes = search->nodes;
+  result.evaluations = search->evaluations;
+  result.eval_hits = search->eval_hits;
+  search_result_pv(search, &result);
+  return result;
+}
+
+void search_print_pv(const search_result_t *result, FILE *fd){
+  for(size_t i = 0; i < result->pv_length; i++){
+    fprintf(fd, "%s%c%ld", i == 0 ? "" : " ",
+      (char) result->pv[i].column + 'a', result->pv[i].row + 1);
+  }
+}
+
+static void search_report(const search_result_t *result, double seconds){
+  fprintf(search_output, "depth %ld score %d nodes %lu time %.2f",
+    result->depth, result->score, (unsigned long) result->nodes, seconds);
+  if(result->researches > 0){
+    fprintf(search_output, " re-searches %ld", result->researches);
+  }
+  if(result->evaluations > 0){
+    fprintf(search_output, " eval hits %.1f%%",
+      100.0 * result->eval_hits / result->evaluations);
+  }
+  fprintf(search_output, " pv ");
+  search_print_pv(result, search_output);
+  fprintf(search_output, "\n");
+  fflush(search_output);
+}
+
+/* computes the time to spend on a move, and the most it may take */
+static void time_allocate(const game_clock_t *clock, board_t *board,
+  double *target, double *maximum){
+  const size_t empties = turns_left(board);
+  size_t endgame = board_size(board) * board_size(board) / 4;
+  if(endgame > TIME_ENDGAME_EMPTIES){
+    endgame = TIME_ENDGAME_EMPTIES;
+  }
+  const double remaining = fmax(clock->remaining - TIME_SAFETY, 0);
+  /* both players move, half of the empty squares are ours */
+  double moves_to_go = (empties + 1) / 2;
+  double usable = remaining;
+  if(empties > endgame){
+    moves_to_go = (empties - endgame + 1) / 2;
+    usable = remaining * (1 - TIME_ENDGAME_RESERVE);
+  }
+  *target = (usable / fmax(moves_to_go, 1)) + clock->increment;
+  switch(stage_of_game(board)){
+    case EARLY_GAME:
+      *target *= TIME_OPENING_FACTOR;
+      break;
+    case MID_GAME:
+      *target *= TIME_MIDGAME_FACTOR;
+      break;
+    default:
+      break;
+  }
+  *maximum = fmax(fmin(*target * TIME_MAXIMUM_FACTOR,
+    (remaining * TIME_MAXIMUM_SHARE) + clock->increment), TIME_MINIMUM);
+  *target = fmin(*target, *maximum);
+}
+
+/* salt of the transposition table keys of a search of a board of size,
+ * from its pruning and the evaluation weights */
+static uint64_t search_salt(const search_t *search, size_t size){
+  uint64_t salt = 0xcbf29ce484222325;
+  salt = hash_bytes(salt, &search->selectivity, sizeof(int));
+  salt = hash_bytes(salt, &search->reductions, sizeof(bool));
+  for(int stage = EARLY_GAME; stage <= END_END_GAME; stage++){
+    heuristic_weights_t weights = get_weights(stage);
+    salt = hash_bytes(salt, &weights, sizeof(heuristic_weights_t));
+  }
+  if(search->selectivity > 0){
+    salt = hash_bytes(salt, probcut[probcut_table(size)],
+      sizeof(probcut[0]));
+  }
+  return salt;
+}
+
+bool search_open_table(const char *filename){
+  const size_t length = TT_HEADER + TT_FILE_SIZE * sizeof(tt_entry_t);
+  int fd = open(filename, O_RDWR | O_CREAT, 0644);
+  if(fd == -1){
+    return false;
+  }
+  /* the file is created empty and grown at once, a process finding it
+   * empty while another one creates it grows it to the same length */
+  struct stat info;
+  if(fstat(fd, &info) == -1 ||
+    (info.st_size == 0 && ftruncate(fd, length) == -1) ||
+    fstat(fd, &info) == -1 || (size_t) info.st_size != length){
+    close(fd);
+    return false;
+  }
+  unsigned char *map = mmap(NULL, length, PROT_READ | PROT_WRITE,
+    MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED){
+    return false;
+  }
+  uint64_t entries = TT_FILE_SIZE;
+  const unsigned char blank[TT_HEADER] = { 0 };
+  if(memcmp(map, blank, TT_HEADER) == 0){
+    /* a new file, the entries are zero and fail their check */
+    memcpy(&map[sizeof(TT_MAGIC) - 1], &entries, sizeof(uint64_t));
+    memcpy(map, TT_MAGIC, sizeof(TT_MAGIC) - 1);
+  } else if(memcmp(map, TT_MAGIC, sizeof(TT_MAGIC) - 1) != 0 ||
+    memcmp(&map[sizeof(TT_MAGIC) - 1], &entries, sizeof(uint64_t)) != 0){
+    munmap(map, length);
+    return false;
+  }
+  search_close_table();
+  shared_table = (tt_entry_t *) &map[TT_HEADER];
+  shared_size = TT_FILE_SIZE;
+  return true;
+}
+
+void search_close_table(void){
+  if(shared_table != NULL){
+    munmap((unsigned char *) shared_table - TT_HEADER,
+      TT_HEADER + shared_size * sizeof(tt_entry_t));
+    shared_table = NULL;
+    shared_size = 0;
+  }
+}
+
+/* Search running in a thread of its own */
+struct search_handle_t
+{
+  pthread_t thread;
+  board_t *board;
+  search_options_t options;
+  atomic_bool stop;
+  /* guards result and done */
+  pthread_mutex_t lock;
+  /* the last completed iteration, then the final result */
+  search_result_t result;
+  bool done;
+};
+
+/* makes result the best so far of the handle */
+static void search_publish(search_handle_t *handle,
+  const search_result_t *result, bool done){
+  pthread_mutex_lock(&handle->lock);
+  handle->result = *result;
+  handle->done = done;
+  pthread_mutex_unlock(&handle->lock);
+}
+
+/* search_position, which publishes every completed iteration into handle
+ * and stops when its flag is set if handle is not NULL */
+static search_result_t search_run(board_t *board,
+  const search_options_t *options, search_handle_t *handle){
+  const size_t depth = options->depth;
+  search_result_t result;
+  result.move = (move_t) { MAX_BOARD_SIZE + 1, MAX_BOARD_SIZE + 1};
+  result.score = -MAX_INT;
+  result.depth = 0;
+  result.exact = false;
+  result.nodes = 0;
+  result.evaluations = 0;
+  result.eval_hits = 0;
+  result.researches = 0;
+  result.pv_length = 0;
+  result.scored = 0;
+  if(board == NULL || depth == 0 || board_player(board) == EMPTY_DISC){
+    return result;
+  }
+  search_t *search = search_new(options->selectivity, options->reductions);
+  if(search == NULL){
+    return result;
+  }
+  uint64_t generation = 0;
+  if(shared_table != NULL){
+    search->table = shared_table;
+    search->table_size = shared_size;
+  } else {
+    search->table = thread_table_get(&generation);
+    search->table_size = TT_SIZE;
+  }
+  if(search->table == NULL){
+    search_free(search);
+    return result;
+  }
+  search->salt = search_salt(search, board_size(board));
+  if(search->table != shared_table){
+    search->salt = hash_bytes(search->salt, &generation, sizeof(uint64_t));
+  }
+  search->max_nodes = options->max_nodes;
+  search->stop = handle != NULL ? &handle->stop : options->stop;
+  search_set_root(search, board);
+  root_move_t roots[SEARCH_MAX_MOVES];
+  size_t count = 0;
+  if(options->analysis){
+    search_ply_t *root = &search->stack[0];
+    search_children(search, root, true);
+    count = root->count;
+    for(size_t i = 0; i < count; i++){
+      const size_t square = root->squares[i];
+      roots[i] = (root_move_t) { square,
+        (move_t) { square / search->size, square % search->size }, 0, 0 };
+    }
+  }
+  double target = 0;
+  size_t stable = 0;
+  double iteration_start = 0;
+  double previous_duration = 0;
+  if(options->clock != NULL){
+    time_allocate(options->clock, board, &target, &search->limit);
+    if(search_output != NULL){
+      fprintf(search_output, "time target %.2f maximum %.2f of %.2f\n",
+        target, search->limit, options->clock->remaining);
+    }
+  }
+  /* iterative deepening, every iteration starts with a window around the
+   * score of the previous one and widens it when the score falls out */
+  for(size_t d = 1; d <= depth && !search->timeout; d++){
+    int score;
+    size_t researches = 0;
+    /* the exact iterations are shared, the cheaper ones would not gain */
+    if(d >= turns_left(board) && options->threads > 1 &&
+      search->parallel == NULL){
+      search->parallel = parallel_new(options->threads);
+    }
+    if(options->analysis){
+      search_all(search, roots, count, d, &researches);
+      score = roots[0].score;
+    } else {
+      score = search_window(search, NULL, d, result.score, d > 1,
+        &researches);
+    }
+    if(search->parallel != NULL){
+      search->nodes += atomic_exchange(&search->parallel->nodes, 0);
+      search->evaluations += atomic_exchange(&search->parallel->evaluations,
+        0);
+      search->eval_hits += atomic_exchange(&search->parallel->eval_hits, 0);
+    }
+    /* an interrupted iteration is only kept if there is nothing else */
+    if(search->timeout && result.depth > 0){
+      break;
+    }
+    move_t previous = result.move;
+    result.score = score;
+    result.depth = d;
+    result.exact = d >= turns_left(board);
+    result.researches += researches;
+    result.nodes = search->nodes;
+    result.evaluations = search->evaluations;
+    result.eval_hits = search->eval_hits;
+    search_result_pv(search, &result);
+    if(options->analysis){
+      result.scored = count;
+      for(size_t i = 0; i < count; i++){
+        result.scores[i] = (move_score_t) { roots[i].move, roots[i].score };
+      }
+      result.move = roots[0].move;
+    }
+    search->hint = result.move;
+    if(handle != NULL){
+      search_publish(handle, &result, false);
+    }
+    if(search_output != NULL){
+      search_report(&result, elapsed(&search->start));
+    }
+    /* deeper iterations reach the end of the game, the score is exact */
+    if(d >= turns_left(board)){
+      break;
+    }
+    if(options->clock != NULL){
+      if(board_count_player_moves(board) == 1){
+        break;
+      }
+      if(d > 1 && (previous.row != result.move.row ||
+        previous.column != result.move.column)){
+        target = fmin(target * TIME_EXTENSION, search->limit);
+        stable = 0;
+      } else {
+        stable++;
+      }
+      /* the next iteration is expected to take as many times longer than
+       * this one as this one took longer than the previous one */
+      const double used = elapsed(&search->start);
+      const double duration = used - iteration_start;
+      double next = duration * TIME_MIN_GROWTH;
+      if(previous_duration > 0 && duration / previous_duration > TIME_MIN_GROWTH){
+        next = duration * duration / previous_duration;
+      }
+      previous_duration = duration;
+      iteration_start = used;
+      if(used + next > target ||
+        (stable >= TIME_STABLE_ITERATIONS && used > target / 4)){
+        break;
+      }
+    }
+  }
+  parallel_free(search->parallel);
+  result.nodes = search->nodes;
+  result.evaluations = search->evaluations;
+  result.eval_hits = search->eval_hits;
+  if(options->clock != NULL){
+    options->clock->remaining += options->clock->increment -
+      elapsed(&search->start);
+  }
+  search_free(search);
+  return result;
+}
+
+search_result_t search_position(board_t *board,
+  const search_options_t *options){
+  return search_run(board, options, NULL);
+}
+
+static void *search_thread(void *argument){
+  search_handle_t *handle = argument;
+  search_result_t result = search_run(handle->board, &handle->options,
+    handle);
+  search_publish(handle, &result, true);
+  return NULL;
+}
+
+search_handle_t *search_start(const board_t *board,
+  const search_options_t *options){
+  search_handle_t *handle = malloc(sizeof(search_handle_t));
+  if(handle == NULL){
+    return NULL;
+  }
+  handle->board = board_copy(board);
+  if(handle->board == NULL){
+    free(handle);
+    return NULL;
+  }
+  handle->options = *options;
+  atomic_init(&handle->stop, false);
+  pthread_mutex_init(&handle->lock, NULL);
+  handle->result.move = (move_t) { MAX_BOARD_SIZE + 1, MAX_BOARD_SIZE + 1};
+  handle->result.score = -MAX_INT;
+  handle->result.depth = 0;
+  handle->result.exact = false;
+  handle->result.nodes = 0;
+  handle->result.evaluations = 0;
+  handle->result.eval_hits = 0;
+  handle->result.researches = 0;
+  handle->result.pv_length = 0;
+  handle->result.scored = 0;
+  handle->done = false;
+  if(pthread_create(&handle->thread, NULL, search_thread, handle) != 0){
+    pthread_mutex_destroy(&handle->lock);
+    board_free(handle->board);
+    free(handle);
+    return NULL;
+  }
+  return handle;
+}
+
+bool search_poll(search_handle_t *handle, search_result_t *result){
+  pthread_mutex_lock(&handle->lock);
+  *result = handle->result;
+  const bool done = handle->done;
+  pthread_mutex_unlock(&handle->lock);
+  return done;
+}
+
+void search_stop(search_handle_t *handle){
+  atomic_store_explicit(&handle->stop, true, memory_order_relaxed);
+}
+
+search_result_t search_wait(search_handle_t *handle){
+  pthread_join(handle->thread, NULL);
+  search_result_t result = handle->result;
+  pthread_mutex_destroy(&handle->lock);
+  board_free(handle->board);
+  free(handle);
+  return result;
+}
+
+bool probcut_save(const char *filename){
+  FILE *fd = fopen(filename, "w");
+  if(fd == NULL){
+    return false;
+  }
+  fprintf(fd, "# size stage depth shallow a b sigma\n");
+  for(size_t table = 0; table < PROBCUT_SIZES; table++){
+    for(int stage = 0; stage < PROBCUT_STAGES; stage++){
+      for(size_t depth = PROBCUT_MIN_DEPTH; depth <= PROBCUT_MAX_DEPTH;
+        depth++){
+        const probcut_t *p = &probcut[table][stage][depth];
+        if(p->sigma > 0){
+          fprintf(fd, "%ld %d %ld %ld %.4f %.3f %.3f\n", 2 * (table + 1),
+            stage, depth, probcut_shallow(depth), p->a, p->b, p->sigma);
+        }
+      }
+    }
+  }
+  return fclose(fd) == 0;
+}
+
+bool probcut_load(const char *filename){
+  FILE *fd = fopen(filename, "r");
+  if(fd == NULL){
+    return false;
+  }
+  probcut_t loaded[PROBCUT_SIZES][PROBCUT_STAGES][PROBCUT_MAX_DEPTH + 1];
+  bool found[PROBCUT_SIZES] = { false };
+  memset(loaded, 0, sizeof(loaded));
+  char *line = NULL;
+  size_t line_size = 0;
+  bool ok = true;
+  while(ok && getline(&line, &line_size, fd) != -1){
+    size_t size = 8;
+    int stage;
+    size_t depth, shallow;
+    probcut_t p;
+    if(line[0] == '#' || line[0] == '\n'){
+      continue;
+    }
+    /* the size came later, the lines of older files have one field less
+     * and hold the parameters of 8x8 */
+    double fields[7];
+    const int count = sscanf(line, "%lf %lf %lf %lf %lf %lf %lf", &fields[0],
+      &fields[1], &fields[2], &fields[3], &fields[4], &fields[5], &fields[6]);
+    if(count == 7){
+      ok = 7 == sscanf(line, "%ld %d %ld %ld %lf %lf %lf", &size, &stage,
+        &depth, &shallow, &p.a, &p.b, &p.sigma);
+    } else {
+      ok = 6 == sscanf(line, "%d %ld %ld %lf %lf %lf", &stage, &depth,
+        &shallow, &p.a, &p.b, &p.sigma);
+    }
+    ok = ok && size >= MIN_BOARD_SIZE && size <= MAX_BOARD_SIZE &&
+      size % 2 == 0 && stage >= 0 && stage < PROBCUT_STAGES &&
+      depth >= PROBCUT_MIN_DEPTH && depth <= PROBCUT_MAX_DEPTH &&
+      shallow == probcut_shallow(depth) && p.a > 0 && p.sigma > 0;
+    if(ok){
+      loaded[probcut_table(size)][stage][depth] = p;
+      found[probcut_table(size)] = true;
+    }
+  }
+  free(line);
+  fclose(fd);
+  /* the sizes missing from the file keep their parameters */
+  for(size_t table = 0; ok && table < PROBCUT_SIZES; table++){
+    if(found[table]){
+      memcpy(probcut[table], loaded[table], sizeof(probcut[table]));
+    }
+  }
+  return ok;
+}
+
+/* reads the positions of a position file that have a player to move */
+static board_t **boards_load(const char *filename, size_t *count){
+  positions_t *positions = positions_open(filename);
+  if(positions == NULL){
+    fprintf(stderr, "reversi: error: Could not open the file %s\n", filename);
+    return NULL;
+  }
+  board_t **boards = NULL;
+  size_t capacity = 0;
+  board_t *board = board_alloc(MAX_BOARD_SIZE, EMPTY_DISC);
+  int label;
+  parse_error_t error;
+  bool ok = true;
+  *count = 0;
+  while(ok && (error = positions_next(positions, board, &label)) !=
+    PARSE_END){
+    if(error != PARSE_OK){
+      fprintf(stderr, "reversi: error: position %ld of %s is malformated\n",
+        positions_line(positions), filename);
+      ok = false;
+    } else if(board_player(board) != EMPTY_DISC){
+      if(*count == capacity){
+        capacity = capacity == 0 ? 1024 : 2 * capacity;
+        board_t **grown = realloc(boards, capacity * sizeof(board_t *));
+        if(grown == NULL){
+          ok = false;
+          break;
+        }
+        boards = grown;
+      }
+      boards[(*count)++] = board_copy(board);
+    }
+  }
+  board_free(board);
+  positions_close(positions);
+  if(!ok){
+    for(size_t i = 0; i < *count; i++){
+      board_free(boards[i]);
+    }
+    free(boards);
+    return NULL;
+  }
+  return boards;
+}
+
+static void boards_free(board_t **boards, size_t count){
+  for(size_t i = 0; i < count; i++){
+    board_free(boards[i]);
+  }
+  free(boards);
+}
+
+/* Sums of the linear regression of the deep values on the shallow values
+ * of one stage and depth */
+typedef struct
+{
+  double n;
+  double x;
+  double y;
+  double xx;
+  double xy;
+  double yy;
+} regression_t;
+
+/* Positions shared by the threads of a fit, each thread sums its own
+ * regressions */
+typedef struct
+{
+  board_t **boards;
+  size_t count;
+  size_t max_depth;
+  atomic_size_t *next;
+  regression_t sums[PROBCUT_SIZES][PROBCUT_STAGES][PROBCUT_MAX_DEPTH + 1];
+  bool threaded;          /* run by a thread of its own, to be joined */
+} fit_job_t;
+
+static void *fit_job_run(void *argument){
+  fit_job_t *job = argument;
+  search_t *search = search_new(0, false);
+  size_t i;
+  while(search != NULL &&
+    (i = atomic_fetch_add(job->next, 1)) < job->count){
+    board_t *board = job->boards[i];
+    game_stage stage = stage_of_game(board);
+    int values[PROBCUT_MAX_DEPTH + 1];
+    size_t max_depth = job->max_depth;
+    /* deeper searches reach the end of the game and are exact */
+    if(max_depth >= turns_left(board)){
+      max_depth = turns_left(board) - 1;
+    }
+    for(size_t depth = 1; depth <= max_depth; depth++){
+      values[depth] = search_fixed(search, board, depth).score;
+    }
+    for(size_t depth = PROBCUT_MIN_DEPTH; depth <= max_depth; depth++){
+      double x = values[probcut_shallow(depth)];
+      double y = values[depth];
+      if(fabs(x) >= SEARCH_WIN || fabs(y) >= SEARCH_WIN){
+        continue;
+      }
+      regression_t *r =
+        &job->sums[probcut_table(board_size(board))][stage][depth];
+      r->n++;
+      r->x += x;
+      r->y += y;
+      r->xx += x * x;
+      r->xy += x * y;
+      r->yy += y * y;
+    }
+  }
+  search_free(search);
+  return NULL;
+}
+
+bool probcut_fit(const char *positions_file, const char *probcut_file,
+  size_t max_depth, size_t threads, bool verbose){
+  size_t count;
+  board_t **boards = boards_load(positions_file, &count);
+  if(boards == NULL){
+    return false;
+  }
+  if(max_depth > PROBCUT_MAX_DEPTH){
+    max_depth = PROBCUT_MAX_DEPTH;
+  }
+  if(threads == 0){
+    threads = 1;
+  }
+  atomic_size_t next;
+  atomic_init(&next, 0);
+  fit_job_t *jobs = calloc(threads, sizeof(fit_job_t));
+  pthread_t *workers = malloc(threads * sizeof(pthread_t));
+  if(jobs == NULL || workers == NULL){
+    free(jobs);
+    free(workers);
+    boards_free(boards, count);
+    return false;
+  }
+  for(size_t t = 0; t < threads; t++){
+    jobs[t].boards = boards;
+    jobs[t].count = count;
+    jobs[t].max_depth = max_depth;
+    jobs[t].next = &next;
+    /* the positions are taken from a shared counter, the threads which
+     * started search those of the threads which could not */
+    jobs[t].threaded = (t > 0) &&
+      pthread_create(&workers[t], NULL, fit_job_run, &jobs[t]) == 0;
+  }
+  fit_job_run(&jobs[0]);
+  regression_t (*sums)[PROBCUT_STAGES][PROBCUT_MAX_DEPTH + 1] = jobs[0].sums;
+  for(size_t t = 1; t < threads; t++){
+    if(!jobs[t].threaded){
+      continue;
+    }
+    pthread_join(workers[t], NULL);
+    for(size_t table = 0; table < PROBCUT_SIZES; table++){
+      for(int stage = 0; stage < PROBCUT_STAGES; stage++){
+        for(size_t depth = 0; depth <= PROBCUT_MAX_DEPTH; depth++){
+          regression_t *sum = &sums[table][stage][depth];
+          const regression_t *r = &jobs[t].sums[table][stage][depth];
+          sum->n += r->n;
+          sum->x += r->x;
+          sum->y += r->y;
+          sum->xx += r->xx;
+          sum->xy += r->xy;
+          sum->yy += r->yy;
+        }
+      }
+    }
+  }
+
+  /* only the sizes of the positions get new parameters */
+  for(size_t table = 0; table < PROBCUT_SIZES; table++){
+    for(int stage = 0; stage < PROBCUT_STAGES; stage++){
+      for(size_t depth = PROBCUT_MIN_DEPTH; depth <= max_depth; depth++){
+        const regression_t *r = &sums[table][stage][depth];
+        if(r->n < PROBCUT_MIN_SAMPLES){
+          continue;
+        }
+        double mean_x = r->x / r->n;
+        double mean_y = r->y / r->n;
+        double variance_x = (r->xx / r->n) - (mean_x * mean_x);
+        double covariance = (r->xy / r->n) - (mean_x * mean_y);
+        double variance_y = (r->yy / r->n) - (mean_y * mean_y);
+        if(variance_x <= 0 || covariance <= 0){
+          continue;
+        }
+        probcut_t *p = &probcut[table][stage][depth];
+        p->a = covariance / variance_x;
+        p->b = mean_y - (p->a * mean_x);
+        p->sigma = sqrt(fmax(variance_y - (p->a * covariance), 1));
+        if(verbose){
+          printf("size %ld stage %d depth %ld/%ld: %.0f pairs, deep = %.3f * "
+            "shallow %+.1f, sigma %.1f\n", 2 * (table + 1), stage, depth,
+            probcut_shallow(depth), r->n, p->a, p->b, p->sigma);
+        }
+      }
+    }
+  }
+  free(jobs);
+  free(workers);
+  boards_free(boards, count);
+  if(!probcut_save(probcut_file)){
+    fprintf(stderr, "reversi: error: Could not write the file %s\n",
+      probcut_file);
+    return false;
+  }
+  return true;
+}
+
+bool search_benchmark(const char *positions_file, size_t depth){
+  size_t count;
+  board_t **boards = boards_load(positions_file, &count);
+  if(boards == NULL){
+    return false;
+  }
+  if(count == 0){
+    fprintf(stderr, "reversi: error: no position to play in %s\n",
+      positions_file);
+    free(boards);
+    return false;
+  }
+  search_result_t *full = malloc(count * sizeof(search_result_t));
+  uint64_t *budgets = malloc(count * sizeof(uint64_t));
+  search_t *search = search_new(0, false);
+  if(full == NULL || budgets == NULL || search == NULL){
+    free(full);
+    free(budgets);
+    search_free(search);
+    boards_free(boards, count);
+    return false;
+  }
+  printf("%ld positions, depth %ld\n", count, depth);
+  printf("search         nodes/position  ms/position  same move  "
+    "score error  depth at equal nodes  eval hits\n");
+  /* the full width search first, then every selectivity level with late
+   * move reductions */
+  for(int level = -1; level <= SEARCH_MAX_SELECTIVITY; level++){
+    const bool reference = level < 0;
+    uint64_t nodes = 0;
+    uint64_t evaluations = 0;
+    uint64_t eval_hits = 0;
+    size_t same = 0;
+    double error = 0;
+    size_t reached = 0;
+    search->selectivity = reference ? 0 : level;
+    search->reductions = !reference;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0; i < count; i++){
+      if(reference){
+        budgets[i] = UINT64_MAX;
+      }
+      search_result_t result = search_fixed(search, boards[i], depth);
+      if(reference){
+        full[i] = result;
+      }
+      nodes += result.nodes;
+      evaluations += result.evaluations;
+      eval_hits += result.eval_hits;
+      if(result.move.row == full[i].move.row &&
+        result.move.column == full[i].move.column){
+        same++;
+      }
+      error += abs(result.score - full[i].score);
+    }
+    double seconds = elapsed(&start);
+    /* deepest iterative deepening done with the nodes that the full width
+     * one needs to reach depth */
+    for(size_t i = 0; i < count; i++){
+      uint64_t used = 0;
+      size_t d;
+      for(d = 1; d < turns_left(boards[i]); d++){
+        used += search_fixed(search, boards[i], d).nodes;
+        if(reference && d == depth){
+          budgets[i] = used;
+        }
+        if(used > budgets[i]){
+          break;
+        }
+      }
+      reached += d - 1;
+    }
+    char name[16];
+    if(reference){
+      snprintf(name, sizeof(name), "full width");
+    } else if(level == 0){
+      snprintf(name, sizeof(name), "lmr");
+    } else {
+      snprintf(name, sizeof(name), "lmr+mpc %d", level);
+    }
+    printf("%-11s  %16.0f  %11.3f  %8.1f%%  %11.1f  %20.2f  %8.1f%%\n", name,
+      (double) nodes / count, 1000 * seconds / count, 100.0 * same / count,
+      error / count, (double) reached / count,
+      evaluations > 0 ? 100.0 * eval_hits / evaluations : 0);
+  }
+  free(full);
+  free(budgets);
+  search_free(search);
+  boards_free(boards, count);
+  return true;
+}
@@ -0,0 +1,568 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <board.h>
+#include <pool.h>
+#include <search.h>
+
+/* connections waiting to be accepted */
+#define SERVER_BACKLOG 128
+/* longest command line, longer ones are answered by an error */
+#define SERVER_LINE 256
+/* bytes read from a connection at once */
+#define SERVER_READ 4096
+/* latencies kept for the statistics, the latest ones */
+#define SERVER_LATENCIES 65536
+/* answers a connection leaves unread, beyond them it is closed */
+#define SERVER_OUTPUT (1 << 20)
+
+typedef struct server_t server_t;
+
+/* One game, on one connection */
+typedef struct
+{
+  int fd;
+  /* NULL until the first new command */
+  board_t *board;
+  game_clock_t clock;
+  char input[SERVER_LINE];
+  size_t input_length;
+  /* the rest of a line too long, skipped up to its end */
+  bool skipping;
+  /* answers not written yet */
+  char *output;
+  size_t output_length;
+  size_t output_capacity;
+  /* a move of the program is being searched, the game waits for it */
+  bool busy;
+  /* the connection is gone, the session is freed once it is not busy */
+  bool closed;
+  /* time of the go command being answered */
+  struct timespec asked;
+} session_t;
+
+/* Move of the program searched by the pool, on copies of the position and
+ * the clock so that the event loop never waits for a worker */
+typedef struct job_t
+{
+  server_t *server;
+  session_t *session;
+  board_t *board;
+  game_clock_t clock;
+  move_t move;
+  struct job_t *next;
+} job_t;
+
+struct server_t
+{
+  pool_t *pool;
+  /* set on shutdown, the searches under way stop */
+  atomic_bool stop;
+  /* pipe written by the workers when a job is done, to wake the loop */
+  int wake[2];
+  /* guards done, the jobs done and not answered yet */
+  pthread_mutex_t lock;
+  job_t *done;
+  session_t **sessions;
+  size_t count;
+  size_t capacity;
+  size_t games;
+  /* moves of the program, their latencies (milliseconds) are a ring */
+  size_t moves;
+  double latencies[SERVER_LATENCIES];
+};
+
+static volatile sig_atomic_t server_stopping = 0;
+
+static void server_signal(int signal){
+  (void) signal;
+  server_stopping = 1;
+}
+
+static bool set_nonblocking(int fd){
+  const int flags = fcntl(fd, F_GETFL, 0);
+  return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+static double elapsed_ms(const struct timespec *start){
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return ((end.tv_sec - start->tv_sec) * 1e3) +
+    ((end.tv_nsec - start->tv_nsec) / 1e6);
+}
+
+/* writes what the connection takes of the pending answers */
+static void session_flush(session_t *session){
+  size_t written = 0;
+  while(written < session->output_length){
+    const ssize_t n = write(session->fd, &session->output[written],
+      session->output_length - written);
+    if(n > 0){
+      written += n;
+    } else if(n == -1 && errno == EINTR){
+      continue;
+    } else {
+      if(n == -1 && errno != EAGAIN && errno != EWOULDBLOCK){
+        session->closed = true;
+      }
+      break;
+    }
+  }
+  memmove(session->output, &session->output[written],
+    session->output_length - written);
+  session->output_length -= written;
+}
+
+/* queues an answer line and writes it if the connection takes it */
+static void session_send(session_t *session, const char *format, ...){
+  if(session->closed){
+    return;
+  }
+  char line[SERVER_LINE + (4 * MAX_BOARD_SIZE * MAX_BOARD_SIZE)];
+  va_list arguments;
+  va_start(arguments, format);
+  int length = vsnprintf(line, sizeof(line) - 1, format, arguments);
+  va_end(arguments);
+  if(length < 0){
+    return;
+  }
+  if((size_t) length > sizeof(line) - 2){
+    length = sizeof(line) - 2;
+  }
+  line[length++] = '\n';
+  /* a client which does not read its answers would grow them forever */
+  if(session->output_length + length > SERVER_OUTPUT){
+    session->closed = true;
+    return;
+  }
+  if(session->output_length + length > session->output_capacity){
+    const size_t capacity = 2 * (session->output_length + length);
+    char *output = realloc(session->output, capacity);
+    if(output == NULL){
+      session->closed = true;
+      return;
+    }
+    session->output = output;
+    session->output_capacity = capacity;
+  }
+  memcpy(&session->output[session->output_length], line, length);
+  session->output_length += length;
+  session_flush(session);
+}
+
+static void session_free(session_t *session){
+  if(session->fd != -1){
+    close(session->fd);
+  }
+  board_free(session->board);
+  free(session->output);
+  free(session);
+}
+
+/* reads a move such as "d3" of a board, false if it is not one */
+static bool parse_move(const board_t *board, const char *text, move_t *move){
+  char column;
+  int row;
+  char rest;
+  if(sscanf(text, " %c%d %c", &column, &row, &rest) != 2 || row < 1 ||
+    column < 'a' || column >= 'a' + (int) board_size(board)){
+    return false;
+  }
+  move->row = row - 1;
+  move->column = column - 'a';
+  return move->row < board_size(board);
+}
+
+/* sends the final discs if the game is over, after prefix */
+static void send_end(session_t *session, const char *prefix){
+  const score_t score = board_score(session->board);
+  session_send(session, "%send %d %d", prefix, score.black, score.white);
+}
+
+static void job_run(void *argument){
+  job_t *job = argument;
+  search_options_t options = { .depth = SEARCH_MAX_PLY,
+    .clock = &job->clock, .max_nodes = 0,
+    .selectivity = get_selectivity(), .reductions = true,
+    .analysis = false, .stop = &job->server->stop };
+  job->move = search_position(job->board, &options).move;
+  server_t *server = job->server;
+  pthread_mutex_lock(&server->lock);
+  job->next = server->done;
+  server->done = job;
+  pthread_mutex_unlock(&server->lock);
+  const char byte = 0;
+  while(write(server->wake[1], &byte, 1) == -1 && errno == EINTR){
+  }
+}
+
+/* answers the moves searched by the pool */
+static void server_answer(server_t *server){
+  char bytes[SERVER_READ];
+  while(read(server->wake[0], bytes, sizeof(bytes)) > 0){
+  }
+  pthread_mutex_lock(&server->lock);
+  job_t *job = server->done;
+  server->done = NULL;
+  pthread_mutex_unlock(&server->lock);
+  while(job != NULL){
+    job_t *next = job->next;
+    session_t *session = job->session;
+    session->busy = false;
+    session->clock = job->clock;
+    if(!session->closed){
+      const move_t move = job->move;
+      server->latencies[server->moves % SERVER_LATENCIES] =
+        elapsed_ms(&session->asked);
+      server->moves++;
+      if(!board_play(session->board, move)){
+        session_send(session, "error no move");
+      } else if(board_player(session->board) == EMPTY_DISC){
+        char prefix[16];
+        snprintf(prefix, sizeof(prefix), "move %c%ld ",
+          (char) move.column + 'a', move.row + 1);
+        send_end(session, prefix);
+      } else {
+        session_send(session, "move %c%ld", (char) move.column + 'a',
+          move.row + 1);
+      }
+    }
+    board_free(job->board);
+    free(job);
+    job = next;
+  }
+}
+
+static int compare_doubles(const void *a, const void *b){
+  const double x = *(const double *) a;
+  const double y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+/* sets the 50th and 99th percentile of the latencies kept */
+static void latency_percentiles(const server_t *server, double *p50,
+  double *p99){
+  const size_t count = server->moves < SERVER_LATENCIES ? server->moves :
+    SERVER_LATENCIES;
+  *p50 = 0;
+  *p99 = 0;
+  double *sorted = malloc(count * sizeof(double));
+  if(count == 0 || sorted == NULL){
+    free(sorted);
+    return;
+  }
+  memcpy(sorted, server->latencies, count * sizeof(double));
+  qsort(sorted, count, sizeof(double), compare_doubles);
+  *p50 = sorted[(count - 1) * 50 / 100];
+  *p99 = sorted[(count - 1) * 99 / 100];
+  free(sorted);
+}
+
+static void server_command(server_t *server, session_t *session,
+  const char *line){
+  char command[16];
+  int used = 0;
+  if(sscanf(line, " %15s%n", command, &used) != 1){
+    return;
+  }
+  const char *arguments = &line[used];
+  if(strcmp(command, "stats") == 0){
+    double p50, p99;
+    latency_percentiles(server, &p50, &p99);
+    session_send(session, "games %ld sessions %ld moves %ld p50 %.2f ms "
+      "p99 %.2f ms", server->games, server->count, server->moves, p50, p99);
+  } else if(strcmp(command, "quit") == 0){
+    session->closed = true;
+  } else if(session->busy){
+    session_send(session, "error busy");
+  } else if(strcmp(command, "new") == 0){
+    int size;
+    double seconds = SERVER_GAME_TIME;
+    board_t *board;
+    if(sscanf(arguments, "%d %lf", &size, &seconds) < 1 || size < 1 ||
+      seconds <= 0 || (board = board_init(size)) == NULL){
+      session_send(session, "error usage: new SIZE [SECONDS]");
+      return;
+    }
+    board_free(session->board);
+    session->board = board;
+    session->clock = (game_clock_t) { seconds, 0 };
+    server->games++;
+    session_send(session, "ok");
+  } else if(session->board == NULL){
+    session_send(session, "error no game");
+  } else if(strcmp(command, "board") == 0){
+    char *text = NULL;
+    size_t length = 0;
+    FILE *stream = open_memstream(&text, &length);
+    if(stream != NULL){
+      board_print_line(session->board, POSITION_NO_LABEL, stream);
+      fclose(stream);
+      text[strcspn(text, "\n")] = '\0';
+      session_send(session, "%s", text);
+    }
+    free(text);
+  } else if(board_player(session->board) == EMPTY_DISC){
+    send_end(session, "");
+  } else if(strcmp(command, "play") == 0){
+    move_t move;
+    if(!parse_move(session->board, arguments, &move) ||
+      !board_play(session->board, move)){
+      session_send(session, "error illegal move");
+    } else if(board_player(session->board) == EMPTY_DISC){
+      send_end(session, "");
+    } else {
+      session_send(session, "ok");
+    }
+  } else if(strcmp(command, "go") == 0){
+    job_t *job = malloc(sizeof(job_t));
+    if(job == NULL || (job->board = board_copy(session->board)) == NULL){
+      free(job);
+      session_send(session, "error out of memory");
+      return;
+    }
+    job->server = server;
+    job->session = session;
+    job->clock = session->clock;
+    clock_gettime(CLOCK_MONOTONIC, &session->asked);
+    session->busy = true;
+    if(!pool_submit(server->pool, job_run, job)){
+      session->busy = false;
+      board_free(job->board);
+      free(job);
+      session_send(session, "error out of memory");
+    }
+  } else {
+    session_send(session, "error unknown command");
+  }
+}
+
+/* reads what the connection sent and runs its complete lines */
+static void session_read(server_t *server, session_t *session){
+  char bytes[SERVER_READ];
+  while(!session->closed){
+    const ssize_t n = read(session->fd, bytes, sizeof(bytes));
+    if(n == -1 && errno == EINTR){
+      continue;
+    }
+    if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+      return;
+    }
+    if(n <= 0){
+      session->closed = true;
+      return;
+    }
+    for(ssize_t i = 0; i < n && !session->closed; i++){
+      if(bytes[i] == '\n'){
+        session->input[session->input_length] = '\0';
+        if(session->skipping){
+          session_send(session, "error line too long");
+        } else {
+          server_command(server, session, session->input);
+        }
+        session->input_length = 0;
+        session->skipping = false;
+      } else if(session->input_length < SERVER_LINE - 1){
+        session->input[session->input_length++] = bytes[i];
+      } else {
+        session->skipping = true;
+      }
+    }
+  }
+}
+
+static void server_accept(server_t *server, int listener){
+  int fd;
+  while((fd = accept(listener, NULL, NULL)) != -1){
+    session_t *session = calloc(1, sizeof(session_t));
+    if(server->count == server->capacity){
+      const size_t capacity = server->capacity == 0 ? 64 :
+        2 * server->capacity;
+      session_t **sessions = realloc(server->sessions,
+        capacity * sizeof(session_t *));
+      if(sessions != NULL){
+        server->sessions = sessions;
+        server->capacity = capacity;
+      }
+    }
+    if(session == NULL || server->count == server->capacity ||
+      !set_nonblocking(fd)){
+      free(session);
+      close(fd);
+      continue;
+    }
+    session->fd = fd;
+    server->sessions[server->count++] = session;
+  }
+}
+
+/* frees the closed sessions whose move is not being searched */
+static void server_sweep(server_t *server){
+  for(size_t i = 0; i < server->count;){
+    session_t *session = server->sessions[i];
+    if(session->closed && session->fd != -1){
+      close(session->fd);
+      session->fd = -1;
+    }
+    if(session->closed && !session->busy){
+      session_free(session);
+      server->sessions[i] = server->sessions[--server->count];
+    } else {
+      i++;
+    }
+  }
+}
+
+/* creates the listening socket of path, -1 on failure */
+static int server_listen(const char *path){
+  struct sockaddr_un address;
+  if(strlen(path) >= sizeof(address.sun_path)){
+    return -1;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(listener == -1){
+    return -1;
+  }
+  unlink(path);
+  if(bind(listener, (struct sockaddr *) &address, sizeof(address)) == -1 ||
+    listen(listener, SERVER_BACKLOG) == -1 || !set_nonblocking(listener)){
+    close(listener);
+    return -1;
+  }
+  return listener;
+}
+
+bool server_run(const char *path, size_t threads, bool verbose){
+  int listener = server_listen(path);
+  if(listener == -1){
+    return false;
+  }
+  server_t *server = calloc(1, sizeof(server_t));
+  if(server == NULL || pipe(server->wake) == -1){
+    free(server);
+    close(listener);
+    unlink(path);
+    return false;
+  }
+  set_nonblocking(server->wake[0]);
+  set_nonblocking(server->wake[1]);
+  pthread_mutex_init(&server->lock, NULL);
+  atomic_init(&server->stop, false);
+  server->pool = pool_new(threads);
+  if(server->pool == NULL){
+    close(server->wake[0]);
+    close(server->wake[1]);
+    pthread_mutex_destroy(&server->lock);
+    free(server);
+    close(listener);
+    unlink(path);
+    return false;
+  }
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = server_signal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  action.sa_handler = SIG_IGN;
+  sigaction(SIGPIPE, &action, NULL);
+  if(verbose){
+    printf("serving on %s with %ld threads\n", path,
+      pool_threads(server->pool));
+    fflush(stdout);
+  }
+  struct pollfd *fds = NULL;
+  size_t fds_capacity = 0;
+  while(!server_stopping){
+    if(fds_capacity < server->count + 2){
+      fds_capacity = 2 * (server->count + 2);
+      struct pollfd *grown = realloc(fds, fds_capacity *
+        sizeof(struct pollfd));
+      if(grown == NULL){
+        break;
+      }
+      fds = grown;
+    }
+    fds[0] = (struct pollfd) { listener, POLLIN, 0 };
+    fds[1] = (struct pollfd) { server->wake[0], POLLIN, 0 };
+    /* the sessions polled are those of this round, accept adds new ones
+     * at the end */
+    const size_t count = server->count;
+    for(size_t i = 0; i < count; i++){
+      const session_t *session = server->sessions[i];
+      fds[i + 2] = (struct pollfd) { session->fd,
+        POLLIN | (session->output_length > 0 ? POLLOUT : 0), 0 };
+    }
+    if(poll(fds, count + 2, -1) == -1){
+      if(errno == EINTR){
+        continue;
+      }
+      break;
+    }
+    if(fds[1].revents != 0){
+      server_answer(server);
+    }
+    for(size_t i = 0; i < count; i++){
+      session_t *session = server->sessions[i];
+      if(session->closed || fds[i + 2].revents == 0){
+        continue;
+      }
+      if(fds[i + 2].revents & POLLOUT){
+        session_flush(session);
+      }
+      if(fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)){
+        session_read(server, session);
+      }
+    }
+    if(fds[0].revents != 0){
+      server_accept(server, listener);
+    }
+    server_sweep(server);
+  }
+  free(fds);
+  /* the searches under way stop and the queued ones return at once, they
+   * all end before their sessions are freed, unanswered */
+  atomic_store(&server->stop, true);
+  pool_free(server->pool);
+  for(size_t i = 0; i < server->count; i++){
+    server->sessions[i]->closed = true;
+  }
+  server_answer(server);
+  double p50, p99;
+  latency_percentiles(server, &p50, &p99);
+  printf("%ld games, %ld moves, latency p50 %.2f ms p99 %.2f ms\n",
+    server->games, server->moves, p50, p99);
+  for(size_t i = 0; i < server->count; i++){
+    session_free(server->sessions[i]);
+  }
+  free(server->sessions);
+  pthread_mutex_destroy(&server->lock);
+  close(server->wake[0]);
+  close(server->wake[1]);
+  free(server);
+  close(listener);
+  unlink(path);
+  return true;
+}
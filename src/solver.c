@@ -0,0 +1,481 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "solver.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <board.h>
+#include <search.h>
+
+/* entries of the table of solved positions, a power of two, it is full at
+ * three quarters */
+#define SOLVER_TABLE_BITS 22
+#define SOLVER_TABLE_SIZE ((size_t) 1 << SOLVER_TABLE_BITS)
+/* the positions this many moves deep are shared out between the threads */
+#define SOLVER_SPLIT_PLIES 4
+/* bytes of the header of a database file */
+#define SOLVER_HEADER 24
+
+/* A solved position, data is SOLVER_READY, the disc difference (bits
+ * 8-15) and the square of the best move (bits 0-7), written after the key
+ * is claimed, so that a key without data is still being solved */
+#define SOLVER_READY (1u << 16)
+typedef struct
+{
+  _Atomic uint64_t key;
+  _Atomic uint32_t data;
+} solver_entry_t;
+
+/* Solving of the positions reachable from a start, shared by the threads */
+typedef struct
+{
+  solver_entry_t *table;
+  atomic_size_t count;
+  atomic_bool full;
+  size_t horizon;
+  /* positions SOLVER_SPLIT_PLIES deep, solved first by the threads */
+  board_t **jobs;
+  size_t jobs_count;
+  atomic_size_t next;
+} solver_t;
+
+/* The loaded database */
+static struct
+{
+  size_t size;
+  size_t count;
+  uint64_t *keys;
+  signed char *values;
+  unsigned char *moves;
+} database = { 0, 0, NULL, NULL, NULL };
+
+/* index of square row, column in the symmetric form s of a board of size
+ * n: transposed if bit 2 is set, then the rows and columns reversed if bits
+ * 0 and 1 are set */
+static size_t transform(int s, size_t n, size_t row, size_t column){
+  if(s & 4){
+    size_t swap = row;
+    row = column;
+    column = swap;
+  }
+  if(s & 1){
+    row = n - 1 - row;
+  }
+  if(s & 2){
+    column = n - 1 - column;
+  }
+  return (row * n) + column;
+}
+
+/* key of the smallest of the 8 symmetric forms of board, whose symmetry is
+ * set into symmetry, and the bit of every symmetry giving it into forms */
+static uint64_t solver_key(const board_t *board, int *symmetry,
+  unsigned *forms){
+  const size_t n = board_size(board);
+  uint64_t powers[SOLVER_MAX_SIZE * SOLVER_MAX_SIZE];
+  uint64_t codes[8] = { 0 };
+  powers[0] = 1;
+  for(size_t i = 1; i < n * n; i++){
+    powers[i] = powers[i - 1] * 3;
+  }
+  for(size_t row = 0; row < n; row++){
+    for(size_t column = 0; column < n; column++){
+      disc_t disc = board_get(board, row, column);
+      uint64_t digit = disc == BLACK_DISC ? 1 : (disc == WHITE_DISC ? 2 : 0);
+      if(digit == 0){
+        continue;
+      }
+      for(int s = 0; s < 8; s++){
+        codes[s] += digit * powers[transform(s, n, row, column)];
+      }
+    }
+  }
+  *symmetry = 0;
+  for(int s = 1; s < 8; s++){
+    if(codes[s] < codes[*symmetry]){
+      *symmetry = s;
+    }
+  }
+  *forms = 0;
+  for(int s = 0; s < 8; s++){
+    if(codes[s] == codes[*symmetry]){
+      *forms |= 1u << s;
+    }
+  }
+  return (codes[*symmetry] * 2) + (board_player(board) == WHITE_DISC) + 1;
+}
+
+/* smallest square of move in the symmetric forms of the bits of forms, so
+ * that a symmetric position stores the same move whatever its orientation */
+static unsigned char square_of(unsigned forms, size_t n, move_t move){
+  size_t square = n * n;
+  for(int s = 0; s < 8; s++){
+    size_t t = transform(s, n, move.row, move.column);
+    if((forms & (1u << s)) && t < square){
+      square = t;
+    }
+  }
+  return square;
+}
+
+/* move of the board whose square in the symmetric form s is square */
+static move_t move_of(int s, size_t n, size_t square){
+  for(size_t row = 0; row < n; row++){
+    for(size_t column = 0; column < n; column++){
+      if(transform(s, n, row, column) == square){
+        return (move_t) { row, column };
+      }
+    }
+  }
+  return (move_t) { MAX_BOARD_SIZE + 1, MAX_BOARD_SIZE + 1 };
+}
+
+static size_t slot_of(uint64_t key){
+  return (key * 0x9E3779B97F4A7C15ULL) >> (64 - SOLVER_TABLE_BITS);
+}
+
+/* reads the data of a solved position, false if it is not solved yet */
+static bool table_find(solver_t *solver, uint64_t key, uint32_t *data){
+  for(size_t i = slot_of(key); ; i = (i + 1) & (SOLVER_TABLE_SIZE - 1)){
+    uint64_t stored = atomic_load(&solver->table[i].key);
+    if(stored == 0){
+      return false;
+    }
+    if(stored == key){
+      *data = atomic_load(&solver->table[i].data);
+      return (*data & SOLVER_READY) != 0;
+    }
+  }
+}
+
+/* stores a solved position, the threads solving it at the same time store
+ * the same data */
+static void table_store(solver_t *solver, uint64_t key, uint32_t data){
+  for(size_t i = slot_of(key); ; i = (i + 1) & (SOLVER_TABLE_SIZE - 1)){
+    uint64_t stored = 0;
+    if(atomic_compare_exchange_strong(&solver->table[i].key, &stored, key)){
+      if(atomic_fetch_add(&solver->count, 1) >= SOLVER_TABLE_SIZE / 4 * 3){
+        atomic_store(&solver->full, true);
+      }
+    } else if(stored != key){
+      continue;
+    }
+    atomic_store(&solver->table[i].data, data);
+    return;
+  }
+}
+
+/* final disc difference for player of a finished game */
+static int final_difference(const board_t *board, disc_t player){
+  score_t score = board_score(board);
+  int difference = score.black - score.white;
+  return player == BLACK_DISC ? difference : -difference;
+}
+
+/* exact value of the position for the player to move, found by minimax
+ * over all its moves so that every position below it is solved too */
+static int solve(solver_t *solver, board_t *board, size_t ply){
+  const size_t n = board_size(board);
+  const disc_t player = board_player(board);
+  int symmetry;
+  unsigned forms;
+  const uint64_t key = solver_key(board, &symmetry, &forms);
+  uint32_t data;
+  if(table_find(solver, key, &data)){
+    return (signed char) ((data >> 8) & 0xff);
+  }
+  if(atomic_load(&solver->full)){
+    return 0;
+  }
+  int best = -MAX_INT;
+  size_t best_square = 0;
+  if(ply >= solver->horizon){
+    /* the searches of a worker reuse the transposition table of its
+     * thread, none allocates its own; the entries are not shared between
+     * the leaves, so that the moves stored do not depend on the order in
+     * which the threads take the jobs */
+    search_options_t options = { .depth = turns_left(board),
+      .clock = NULL, .selectivity = 0, .reductions = false };
+    search_result_t result = search_position(board, &options);
+    best = result.score;
+    if(best >= SEARCH_WIN){
+      best -= SEARCH_WIN;
+    } else if(best <= -SEARCH_WIN){
+      best += SEARCH_WIN;
+    }
+    best_square = square_of(forms, n, result.move);
+  } else {
+    size_t count = board_count_player_moves(board);
+    for(size_t i = 0; i < count; i++){
+      move_t move = board_next_move(board);
+      board_t *child = board_copy(board);
+      board_play(child, move);
+      int value;
+      if(board_player(child) == EMPTY_DISC){
+        value = final_difference(child, player);
+      } else if(board_player(child) == player){
+        value = solve(solver, child, ply + 1);
+      } else {
+        value = -solve(solver, child, ply + 1);
+      }
+      board_free(child);
+      /* of equal moves the one of the smallest square */
+      const size_t square = square_of(forms, n, move);
+      if(value > best || (value == best && square < best_square)){
+        best = value;
+        best_square = square;
+      }
+    }
+  }
+  table_store(solver, key, SOLVER_READY |
+    ((uint32_t) (unsigned char) (signed char) best << 8) | best_square);
+  return best;
+}
+
+/* collects the positions plies moves below board as jobs, transposed ones
+ * are only solved once thanks to the table */
+static bool collect_jobs(solver_t *solver, board_t *board, size_t plies,
+  size_t *capacity){
+  if(board_player(board) == EMPTY_DISC){
+    return true;
+  }
+  if(plies == 0){
+    if(solver->jobs_count == *capacity){
+      *capacity = *capacity == 0 ? 256 : 2 * *capacity;
+      board_t **grown = realloc(solver->jobs, *capacity * sizeof(board_t *));
+      if(grown == NULL){
+        return false;
+      }
+      solver->jobs = grown;
+    }
+    solver->jobs[solver->jobs_count++] = board_copy(board);
+    return true;
+  }
+  size_t count = board_count_player_moves(board);
+  bool ok = true;
+  for(size_t i = 0; i < count; i++){
+    move_t move = board_next_move(board);
+    board_t *child = board_copy(board);
+    board_play(child, move);
+    ok = ok && collect_jobs(solver, child, plies - 1, capacity);
+    board_free(child);
+  }
+  return ok;
+}
+
+static void *solver_worker(void *argument){
+  solver_t *solver = argument;
+  size_t i;
+  while((i = atomic_fetch_add(&solver->next, 1)) < solver->jobs_count){
+    solve(solver, solver->jobs[i], SOLVER_SPLIT_PLIES);
+  }
+  return NULL;
+}
+
+static int compare_keys(const void *a, const void *b){
+  const uint64_t x = *(const uint64_t *) a;
+  const uint64_t y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
+
+static void write_le(uint64_t value, FILE *fd){
+  for(int i = 0; i < 8; i++){
+    fputc((value >> (8 * i)) & 0xff, fd);
+  }
+}
+
+/* writes the solved positions sorted by key, false on failure */
+static bool solver_save(solver_t *solver, size_t size, const char *filename){
+  const size_t count = atomic_load(&solver->count);
+  uint64_t *keys = malloc(count * sizeof(uint64_t) + 1);
+  FILE *fd = fopen(filename, "w");
+  if(keys == NULL || fd == NULL){
+    free(keys);
+    if(fd != NULL){
+      fclose(fd);
+    }
+    return false;
+  }
+  size_t stored = 0;
+  for(size_t i = 0; i < SOLVER_TABLE_SIZE && stored < count; i++){
+    uint64_t key = atomic_load(&solver->table[i].key);
+    if(key != 0){
+      keys[stored++] = key;
+    }
+  }
+  qsort(keys, stored, sizeof(uint64_t), compare_keys);
+  fputs(SOLVER_MAGIC, fd);
+  write_le(size, fd);
+  write_le(stored, fd);
+  for(size_t i = 0; i < stored; i++){
+    write_le(keys[i], fd);
+  }
+  uint32_t data;
+  for(size_t i = 0; i < stored; i++){
+    table_find(solver, keys[i], &data);
+    fputc((data >> 8) & 0xff, fd);
+  }
+  for(size_t i = 0; i < stored; i++){
+    table_find(solver, keys[i], &data);
+    fputc(data & 0xff, fd);
+  }
+  free(keys);
+  bool ok = !ferror(fd);
+  return fclose(fd) == 0 && ok;
+}
+
+bool solver_build(const board_t *start, size_t horizon, size_t threads,
+  const char *filename, bool verbose){
+  const size_t size = board_size(start);
+  if(size > SOLVER_MAX_SIZE){
+    fprintf(stderr, "reversi: error: boards larger than %dx%d cannot be "
+      "solved\n", SOLVER_MAX_SIZE, SOLVER_MAX_SIZE);
+    return false;
+  }
+  if(board_player(start) == EMPTY_DISC){
+    fprintf(stderr, "reversi: error: the game is already over\n");
+    return false;
+  }
+  if(threads == 0){
+    threads = 1;
+  }
+  solver_t solver = { .horizon = horizon, .jobs = NULL, .jobs_count = 0 };
+  solver.table = calloc(SOLVER_TABLE_SIZE, sizeof(solver_entry_t));
+  pthread_t *workers = malloc(threads * sizeof(pthread_t));
+  atomic_init(&solver.count, 0);
+  atomic_init(&solver.full, false);
+  atomic_init(&solver.next, 0);
+  struct timespec begin, end;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  board_t *root = board_copy(start);
+  size_t capacity = 0;
+  bool ok = solver.table != NULL && workers != NULL && root != NULL;
+  if(ok && horizon > SOLVER_SPLIT_PLIES){
+    ok = collect_jobs(&solver, root, SOLVER_SPLIT_PLIES, &capacity);
+  }
+  int value = 0;
+  if(ok){
+    /* the workers take the jobs from a shared counter, so the jobs of a
+     * thread that could not be created are taken by the others */
+    size_t started = 1;
+    while(started < threads &&
+      pthread_create(&workers[started], NULL, solver_worker, &solver) == 0){
+      started++;
+    }
+    solver_worker(&solver);
+    for(size_t t = 1; t < started; t++){
+      pthread_join(workers[t], NULL);
+    }
+    /* the positions above the jobs, which are all solved */
+    value = solve(&solver, root, 0);
+  }
+  if(ok && atomic_load(&solver.full)){
+    fprintf(stderr, "reversi: error: more than %ld positions, use a shorter "
+      "horizon (-d)\n", SOLVER_TABLE_SIZE / 4 * 3);
+    ok = false;
+  }
+  if(ok && !solver_save(&solver, size, filename)){
+    fprintf(stderr, "reversi: error: Could not write the file %s\n",
+      filename);
+    ok = false;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  if(ok && verbose){
+    printf("%ld positions solved in %.2f s, value %+d for '%c'\n",
+      atomic_load(&solver.count), (end.tv_sec - begin.tv_sec) +
+      (end.tv_nsec - begin.tv_nsec) / 1e9, value, board_player(start));
+  }
+  for(size_t i = 0; i < solver.jobs_count; i++){
+    board_free(solver.jobs[i]);
+  }
+  free(solver.jobs);
+  free(solver.table);
+  free(workers);
+  board_free(root);
+  return ok;
+}
+
+static uint64_t read_le(const unsigned char *bytes){
+  uint64_t value = 0;
+  for(int i = 7; i >= 0; i--){
+    value = (value << 8) | bytes[i];
+  }
+  return value;
+}
+
+bool solver_load(const char *filename){
+  FILE *fd = fopen(filename, "r");
+  if(fd == NULL){
+    return false;
+  }
+  unsigned char header[SOLVER_HEADER];
+  bool ok = fread(header, 1, SOLVER_HEADER, fd) == SOLVER_HEADER &&
+    memcmp(header, SOLVER_MAGIC, 8) == 0;
+  const uint64_t size = ok ? read_le(&header[8]) : 0;
+  const uint64_t count = ok ? read_le(&header[16]) : 0;
+  ok = ok && size >= MIN_BOARD_SIZE && size <= SOLVER_MAX_SIZE &&
+    count <= SIZE_MAX / 16;
+  uint64_t *keys = ok ? malloc(count * sizeof(uint64_t) + 1) : NULL;
+  signed char *values = ok ? malloc(count + 1) : NULL;
+  unsigned char *moves = ok ? malloc(count + 1) : NULL;
+  ok = ok && keys != NULL && values != NULL && moves != NULL;
+  unsigned char bytes[8];
+  for(size_t i = 0; ok && i < count; i++){
+    ok = fread(bytes, 1, 8, fd) == 8;
+    keys[i] = read_le(bytes);
+    /* binary searches need the keys in order */
+    ok = ok && (i == 0 || keys[i - 1] < keys[i]);
+  }
+  ok = ok && fread(values, 1, count, fd) == count &&
+    fread(moves, 1, count, fd) == count && fgetc(fd) == EOF;
+  fclose(fd);
+  if(!ok){
+    free(keys);
+    free(values);
+    free(moves);
+    return false;
+  }
+  free(database.keys);
+  free(database.values);
+  free(database.moves);
+  database.size = size;
+  database.count = count;
+  database.keys = keys;
+  database.values = values;
+  database.moves = moves;
+  return true;
+}
+
+bool solver_lookup(const board_t *board, int *value, move_t *move){
+  if(database.keys == NULL || board_size(board) != database.size ||
+    board_player(board) == EMPTY_DISC){
+    return false;
+  }
+  int symmetry;
+  unsigned forms;
+  const uint64_t key = solver_key(board, &symmetry, &forms);
+  size_t low = 0;
+  size_t high = database.count;
+  while(low < high){
+    size_t middle = low + (high - low) / 2;
+    if(database.keys[middle] < key){
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if(low == database.count || database.keys[low] != key){
+    return false;
+  }
+  *value = database.values[low];
+  *move = move_of(symmetry, database.size, database.moves[low]);
+  return true;
+}
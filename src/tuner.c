@@ -0,0 +1,336 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "tuner.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <board.h>
+#include <player.h>
+
+/* features of a position: score, mobility, stable, frontiers, the 8
+ * regions, potential mobility and parity, in the order of the weights */
+#define TUNE_FEATURES 14
+#define TUNE_STAGES 4
+#define TUNE_BATCH 64
+
+/* Feature matrix of the training positions, computed once */
+typedef struct
+{
+  size_t count;
+  size_t capacity;
+  /* count rows of TUNE_FEATURES, every feature is a difference of at most
+   * MAX_BOARD_SIZE * MAX_BOARD_SIZE squares (256), beyond a signed byte */
+  int16_t *features;
+  uint8_t *stages;
+  float *results;       /* 1 black won, 0.5 draw, 0 white won */
+} samples_t;
+
+/* Work of one thread for one pass over its share of the samples */
+typedef struct
+{
+  const samples_t *samples;
+  size_t first;
+  size_t last;
+  const double *weights;  /* TUNE_STAGES rows of TUNE_FEATURES */
+  double scale;
+  double loss;
+  double gradient[TUNE_STAGES * TUNE_FEATURES];
+  bool threaded;          /* run by a thread of its own, to be joined */
+} tune_job_t;
+
+static bool samples_grow(samples_t *samples){
+  size_t capacity = samples->capacity == 0 ? 65536 : 2 * samples->capacity;
+  int16_t *features = realloc(samples->features,
+    capacity * TUNE_FEATURES * sizeof(int16_t));
+  if(features == NULL){
+    return false;
+  }
+  samples->features = features;
+  uint8_t *stages = realloc(samples->stages, capacity * sizeof(uint8_t));
+  if(stages == NULL){
+    return false;
+  }
+  samples->stages = stages;
+  float *results = realloc(samples->results, capacity * sizeof(float));
+  if(results == NULL){
+    return false;
+  }
+  samples->results = results;
+  samples->capacity = capacity;
+  return true;
+}
+
+static void samples_free(samples_t *samples){
+  free(samples->features);
+  free(samples->stages);
+  free(samples->results);
+}
+
+/* evaluates a batch of boards (of the same size) and appends them */
+static bool samples_add(samples_t *samples, board_t *const boards[],
+  const int labels[], size_t count){
+  board_features_t features[TUNE_BATCH];
+  board_features_batch(boards, count, BLACK_DISC, features);
+  for(size_t i = 0; i < count; i++){
+    if(samples->count == samples->capacity && !samples_grow(samples)){
+      return false;
+    }
+    int16_t *row = &samples->features[samples->count * TUNE_FEATURES];
+    row[0] = (int16_t) features[i].score;
+    row[1] = (int16_t) features[i].mobility;
+    row[2] = (int16_t) features[i].stable;
+    row[3] = (int16_t) features[i].frontiers;
+    for(int r = 0; r < 8; r++){
+      row[4 + r] = (int16_t) features[i].regions[r];
+    }
+    row[12] = (int16_t) features[i].potential_mobility;
+    row[13] = (int16_t) features[i].parity;
+    samples->stages[samples->count] = stage_of_game(boards[i]);
+    if(labels[i] > 0){
+      samples->results[samples->count] = 1.0f;
+    } else if(labels[i] < 0){
+      samples->results[samples->count] = 0.0f;
+    } else {
+      samples->results[samples->count] = 0.5f;
+    }
+    samples->count++;
+  }
+  return true;
+}
+
+static bool samples_load(samples_t *samples, const char *filename){
+  positions_t *positions = positions_open(filename);
+  if(positions == NULL){
+    fprintf(stderr, "reversi: error: Could not open the file %s\n", filename);
+    return false;
+  }
+  board_t *boards[TUNE_BATCH];
+  int labels[TUNE_BATCH];
+  size_t count = 0;
+  for(size_t i = 0; i < TUNE_BATCH; i++){
+    boards[i] = board_alloc(MAX_BOARD_SIZE, EMPTY_DISC);
+  }
+  bool ok = true;
+  parse_error_t error;
+  while(ok && (error = positions_next(positions, boards[count],
+    &labels[count])) != PARSE_END){
+    if(error != PARSE_OK){
+      fprintf(stderr, "reversi: error: position %ld of %s is malformated\n",
+        positions_line(positions), filename);
+      ok = false;
+    } else if(labels[count] != POSITION_NO_LABEL){
+      /* a batch holds boards of one size only */
+      if(count > 0 && board_size(boards[count]) != board_size(boards[0])){
+        ok = samples_add(samples, boards, labels, count);
+        board_t *first = boards[0];
+        boards[0] = boards[count];
+        boards[count] = first;
+        labels[0] = labels[count];
+        count = 0;
+      }
+      count++;
+      if(ok && count == TUNE_BATCH){
+        ok = samples_add(samples, boards, labels, count);
+        count = 0;
+      }
+    }
+  }
+  if(ok && count > 0){
+    ok = samples_add(samples, boards, labels, count);
+  }
+  for(size_t i = 0; i < TUNE_BATCH; i++){
+    board_free(boards[i]);
+  }
+  positions_close(positions);
+  return ok;
+}
+
+static void *tune_job_run(void *argument){
+  tune_job_t *job = argument;
+  const samples_t *samples = job->samples;
+  job->loss = 0;
+  memset(job->gradient, 0, sizeof(job->gradient));
+  for(size_t i = job->first; i < job->last; i++){
+    const int16_t *row = &samples->features[i * TUNE_FEATURES];
+    const double *w = &job->weights[samples->stages[i] * TUNE_FEATURES];
+    double evaluation = 0;
+    for(int f = 0; f < TUNE_FEATURES; f++){
+      evaluation += w[f] * row[f];
+    }
+    const double prediction = 1.0 / (1.0 + exp(-evaluation / job->scale));
+    const double result = samples->results[i];
+    const double error = prediction - result;
+    /* cross entropy of the logistic regression, the prediction is kept
+     * off 0 and 1 so that a confident miss costs a finite loss */
+    const double p = fmin(fmax(prediction, 1e-12), 1 - 1e-12);
+    job->loss -= (result * log(p)) + ((1 - result) * log(1 - p));
+    /* its gradient, error * feature over the scale */
+    double *g = &job->gradient[samples->stages[i] * TUNE_FEATURES];
+    for(int f = 0; f < TUNE_FEATURES; f++){
+      g[f] += error * row[f];
+    }
+  }
+  return NULL;
+}
+
+/* one parallel pass over the samples, returns the mean cross entropy and
+ * its mean gradient. A share whose thread cannot be started is run by the
+ * calling thread */
+static double tune_pass(const samples_t *samples, const double *weights,
+  const double scale, tune_job_t *jobs, pthread_t *workers,
+  const size_t threads, double *gradient){
+  size_t share = (samples->count + threads - 1) / threads;
+  for(size_t t = 0; t < threads; t++){
+    jobs[t].samples = samples;
+    jobs[t].first = t * share < samples->count ? t * share : samples->count;
+    jobs[t].last = (t + 1) * share < samples->count ?
+      (t + 1) * share : samples->count;
+    jobs[t].weights = weights;
+    jobs[t].scale = scale;
+    jobs[t].threaded = (t > 0) &&
+      pthread_create(&workers[t], NULL, tune_job_run, &jobs[t]) == 0;
+  }
+  for(size_t t = 0; t < threads; t++){
+    if(!jobs[t].threaded){
+      tune_job_run(&jobs[t]);
+    }
+  }
+  double loss = jobs[0].loss;
+  memcpy(gradient, jobs[0].gradient, sizeof(jobs[0].gradient));
+  for(size_t t = 1; t < threads; t++){
+    if(jobs[t].threaded){
+      pthread_join(workers[t], NULL);
+    }
+    loss += jobs[t].loss;
+    for(int k = 0; k < TUNE_STAGES * TUNE_FEATURES; k++){
+      gradient[k] += jobs[t].gradient[k];
+    }
+  }
+  for(int k = 0; k < TUNE_STAGES * TUNE_FEATURES; k++){
+    gradient[k] /= (samples->count * scale);
+  }
+  return loss / samples->count;
+}
+
+static void weights_to_array(double *array){
+  for(int stage = 0; stage < TUNE_STAGES; stage++){
+    heuristic_weights_t w = get_weights(stage);
+    double *row = &array[stage * TUNE_FEATURES];
+    row[0] = w.score;
+    row[1] = w.mobility;
+    row[2] = w.stable;
+    row[3] = w.frontiers;
+    for(int r = 0; r < 8; r++){
+      row[4 + r] = w.regions[r];
+    }
+    row[12] = w.potential_mobility;
+    row[13] = w.parity;
+  }
+}
+
+static void array_to_weights(const double *array){
+  for(int stage = 0; stage < TUNE_STAGES; stage++){
+    const double *row = &array[stage * TUNE_FEATURES];
+    heuristic_weights_t w;
+    w.score = lround(row[0]);
+    w.mobility = lround(row[1]);
+    w.stable = lround(row[2]);
+    w.frontiers = lround(row[3]);
+    for(int r = 0; r < 8; r++){
+      w.regions[r] = lround(row[4 + r]);
+    }
+    w.potential_mobility = lround(row[12]);
+    w.parity = lround(row[13]);
+    set_weights(stage, w);
+  }
+}
+
+bool tune_weights(const char *positions_file, const char *weights_file,
+  size_t iterations, size_t threads, bool verbose){
+  samples_t samples = { 0, 0, NULL, NULL, NULL };
+  if(!samples_load(&samples, positions_file)){
+    samples_free(&samples);
+    return false;
+  }
+  if(samples.count == 0){
+    fprintf(stderr, "reversi: error: no labeled position in %s\n",
+      positions_file);
+    samples_free(&samples);
+    return false;
+  }
+  if(threads == 0){
+    threads = 1;
+  }
+  tune_job_t *jobs = malloc(threads * sizeof(tune_job_t));
+  pthread_t *workers = malloc(threads * sizeof(pthread_t));
+  if(jobs == NULL || workers == NULL){
+    fprintf(stderr, "reversi: error: out of memory\n");
+    free(jobs);
+    free(workers);
+    samples_free(&samples);
+    return false;
+  }
+  double weights[TUNE_STAGES * TUNE_FEATURES];
+  double gradient[TUNE_STAGES * TUNE_FEATURES];
+  weights_to_array(weights);
+
+  /* the scale turning evaluations into win probabilities is fitted first
+   * on the current weights, then kept. Both minimize the cross entropy
+   * that the gradient descends */
+  double scale = 1;
+  double best = tune_pass(&samples, weights, scale, jobs, workers, threads,
+    gradient);
+  for(double s = 2; s <= 10000; s *= 1.25){
+    double loss = tune_pass(&samples, weights, s, jobs, workers, threads,
+      gradient);
+    if(loss < best){
+      best = loss;
+      scale = s;
+    }
+  }
+  if(verbose){
+    printf("%ld labeled positions, scale %.1f, initial cross entropy %.6f\n",
+      samples.count, scale, best);
+  }
+
+  /* Adam */
+  const double rate = 0.5;
+  const double beta_1 = 0.9;
+  const double beta_2 = 0.999;
+  double moment_1[TUNE_STAGES * TUNE_FEATURES] = { 0 };
+  double moment_2[TUNE_STAGES * TUNE_FEATURES] = { 0 };
+  double loss = best;
+  for(size_t i = 1; i <= iterations; i++){
+    loss = tune_pass(&samples, weights, scale, jobs, workers, threads,
+      gradient);
+    for(int k = 0; k < TUNE_STAGES * TUNE_FEATURES; k++){
+      moment_1[k] = (beta_1 * moment_1[k]) + ((1 - beta_1) * gradient[k]);
+      moment_2[k] = (beta_2 * moment_2[k]) +
+        ((1 - beta_2) * gradient[k] * gradient[k]);
+      double m = moment_1[k] / (1 - pow(beta_1, i));
+      double v = moment_2[k] / (1 - pow(beta_2, i));
+      weights[k] -= rate * m / (sqrt(v) + 1e-12);
+    }
+    if(verbose && (i % 100 == 0 || i == iterations)){
+      printf("iteration %ld: cross entropy %.6f\n", i, loss);
+    }
+  }
+  free(jobs);
+  free(workers);
+  samples_free(&samples);
+
+  array_to_weights(weights);
+  if(!save_weights(weights_file)){
+    fprintf(stderr, "reversi: error: Could not write the file %s\n",
+      weights_file);
+    return false;
+  }
+  return true;
+}